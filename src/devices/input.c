@@ -41,6 +41,31 @@ input_getc (void)
   return key;
 }
 
+/* Retrieves up to SIZE keys from the input buffer into BUF,
+   waiting only if the buffer is empty, and stopping after a
+   carriage return or new-line so that a reader gets at most one
+   line.  Returns the number of keys retrieved, which is at least
+   1 if SIZE is nonzero. */
+size_t
+input_read (uint8_t *buf, size_t size)
+{
+  enum intr_level old_level;
+  size_t cnt = 0;
+
+  old_level = intr_disable ();
+  while (cnt < size && (cnt == 0 || !intq_empty (&buffer)))
+    {
+      uint8_t key = intq_getc (&buffer);
+      buf[cnt++] = key;
+      if (key == '\r' || key == '\n')
+        break;
+    }
+  serial_notify ();
+  intr_set_level (old_level);
+
+  return cnt;
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
@@ -129,6 +129,43 @@ serial_putc (uint8_t byte)
   intr_set_level (old_level);
 }
 
+/* Sends the SIZE bytes in BUF to the serial port, like
+   serial_putc() on each byte but disabling interrupts and
+   updating the interrupt enable register once for the run. */
+void
+serial_putbuf (const uint8_t *buf, size_t size)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (mode != QUEUE)
+    {
+      if (mode == UNINIT)
+        init_poll ();
+      while (size-- > 0)
+        putc_poll (*buf++);
+    }
+  else
+    {
+      while (size-- > 0)
+        {
+          if (intq_full (&txq))
+            {
+              /* As in serial_putc(), poll a byte out if we may
+                 not wait; otherwise make sure the transmit
+                 interrupt is on before intq_putc() waits for it. */
+              if (old_level == INTR_OFF)
+                putc_poll (intq_getc (&txq));
+              else
+                write_ier ();
+            }
+          intq_putc (&txq, *buf++);
+        }
+      write_ier ();
+    }
+
+  intr_set_level (old_level);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
    mode. */
 void
@@ -51,11 +51,23 @@ main (void)
 static void
 read_line (char line[], size_t size)
 {
+  /* Keys read from the console but not yet handled.  A read
+     returns all keys typed so far, up to the end of a line. */
+  static char input[64];
+  static int input_ofs, input_cnt;
+
   char *pos = line;
   for (;;)
     {
       char c;
-      read (STDIN_FILENO, &c, 1);
+      if (input_ofs >= input_cnt)
+        {
+          input_cnt = read (STDIN_FILENO, input, sizeof input);
+          input_ofs = 0;
+          if (input_cnt <= 0)
+            continue;
+        }
+      c = input[input_ofs++];
 
       switch (c)
         {
@@ -0,0 +1,87 @@
+/* spawn-bench.c
+
+   Measures the latency of spawning a process: exec() of a child
+   that exits at once, followed by wait() for it.  Then spawns a
+   chain of processes, each the parent of the next, in the manner
+   of multi-recurse.
+
+   Usage: spawn-bench [ITERATIONS [DEPTH]]
+   Prints the average cost of one exec() and wait() pair, and of
+   one level of the chain, in CPU cycles, as counted by the
+   time-stamp counter. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+/* Runs COMMAND and waits for it.  Returns its exit status, or -1
+   if it could not be started. */
+static int
+spawn (const char *command)
+{
+  pid_t pid = exec (command);
+  return pid == PID_ERROR ? -1 : wait (pid);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 100;
+  int depth = argc > 2 ? atoi (argv[2]) : 10;
+  uint64_t start, flat_cycles, chain_cycles;
+  char command[64];
+  int i;
+
+  /* "spawn-bench -c" exits at once; "spawn-bench -r N" spawns a
+     chain of N more processes. */
+  if (argc > 1 && !strcmp (argv[1], "-c"))
+    return EXIT_SUCCESS;
+  if (argc > 2 && !strcmp (argv[1], "-r"))
+    {
+      int n = atoi (argv[2]);
+      if (n <= 0)
+        return EXIT_SUCCESS;
+      snprintf (command, sizeof command, "spawn-bench -r %d", n - 1);
+      return spawn (command);
+    }
+
+  if (iterations <= 0 || depth <= 0)
+    {
+      printf ("usage: spawn-bench [ITERATIONS [DEPTH]]\n");
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    if (spawn ("spawn-bench -c") != EXIT_SUCCESS)
+      {
+        printf ("spawn-bench: exec failed\n");
+        return EXIT_FAILURE;
+      }
+  flat_cycles = rdtsc () - start;
+
+  snprintf (command, sizeof command, "spawn-bench -r %d", depth);
+  start = rdtsc ();
+  if (spawn (command) != EXIT_SUCCESS)
+    {
+      printf ("spawn-bench: exec failed\n");
+      return EXIT_FAILURE;
+    }
+  chain_cycles = rdtsc () - start;
+
+  printf ("%d spawns: %llu cycles per spawn\n", iterations,
+          flat_cycles / iterations);
+  printf ("chain of %d: %llu cycles per level\n", depth,
+          chain_cycles / (depth + 1));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+/* syscall-bench.c
+
+   Measures the latency of a near-null system call: isdir() on a
+   file descriptor that is not open, which does nothing but
+   dispatch, copy its argument in and look up the descriptor.
+
+   Usage: syscall-bench [ITERATIONS]
+   Prints the average cost of one call in CPU cycles, as counted
+   by the time-stamp counter, with the loop overhead subtracted. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 100000;
+  uint64_t start, loop_cycles, call_cycles;
+  int i;
+
+  if (iterations <= 0)
+    {
+      printf ("usage: syscall-bench [ITERATIONS]\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Loop overhead alone. */
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    asm volatile("" : : : "memory");
+  loop_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    isdir (-1);
+  call_cycles = rdtsc () - start;
+
+  printf ("%d calls: %llu cycles per call\n", iterations,
+          (call_cycles - loop_cycles) / iterations);
+  return EXIT_SUCCESS;
+}
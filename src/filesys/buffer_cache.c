@@ -1,5 +1,6 @@
 #include "buffer_cache.h"
 #include "devices/timer.h"
+#include "filesys/journal.h"
 #include "lib/debug.h"
 #include "lib/string.h"
 #include "list.h"
@@ -18,6 +19,8 @@ buffer_cache_find_sector (block_sector_t sector);
 static struct buffer_cache_node *buffer_cache_find_empty (void);
 static size_t buffer_cache_find_victim (void);
 static void buffer_cache_flush (size_t i);
+static void buffer_cache_write_node (block_sector_t sector, const void *src,
+                                     off_t offset, off_t length, bool pin);
 static void write_behind (void);
 
 void
@@ -51,6 +54,7 @@ buffer_cache_read (block_sector_t sector, void *dest, off_t offset,
       node->sector = sector;
       node->in_use = true;
       node->dirty = false;
+      node->pinned = false;
       // Add size
       cache_size++;
     }
@@ -72,6 +76,7 @@ buffer_cache_prefetch (block_sector_t sector)
       block_read (fs_device, sector, node->buffer);
       node->sector = sector;
       node->dirty = false;
+      node->pinned = false;
       node->in_use = true;
       cache_size++;
     }
@@ -83,6 +88,34 @@ buffer_cache_prefetch (block_sector_t sector)
 void
 buffer_cache_write (block_sector_t sector, const void *src, off_t offset,
                     off_t length)
+{
+  buffer_cache_write_node (sector, src, offset, length, false);
+}
+
+/* Like buffer_cache_write(), for a metadata sector that the caller
+   logs with journal_log().  The sector is not written back until
+   the journal has committed it. */
+void
+buffer_cache_write_meta (block_sector_t sector, const void *src,
+                         off_t offset, off_t length)
+{
+  buffer_cache_write_node (sector, src, offset, length, true);
+}
+
+/* Let write-behind and eviction write SECTOR back again. */
+void
+buffer_cache_unpin (block_sector_t sector)
+{
+  lock_acquire (&buffer_cache_lock);
+  struct buffer_cache_node *node = buffer_cache_find_sector (sector);
+  if (node)
+    node->pinned = false;
+  lock_release (&buffer_cache_lock);
+}
+
+static void
+buffer_cache_write_node (block_sector_t sector, const void *src, off_t offset,
+                         off_t length, bool pin)
 {
   ASSERT (offset + length <= BLOCK_SECTOR_SIZE);
   lock_acquire (&buffer_cache_lock);
@@ -95,10 +128,12 @@ buffer_cache_write (block_sector_t sector, const void *src, off_t offset,
       block_read (fs_device, sector, node->buffer);
       node->sector = sector;
       node->in_use = true;
+      node->pinned = false;
       cache_size++;
     }
   node->access = true;
   node->dirty = true;
+  node->pinned |= pin;
   // write the data
   memcpy (node->buffer + offset, src, length);
   lock_release (&buffer_cache_lock);
@@ -164,8 +199,8 @@ buffer_cache_find_victim ()
   for (int i = 0; i < 2 * BUFFER_CACHE_SIZE;
        i++, clock_pointer = (clock_pointer + 1) % BUFFER_CACHE_SIZE)
     {
-      // Skip empty
-      if (!cache[clock_pointer].in_use)
+      // Skip empty, and metadata the journal has not committed
+      if (!cache[clock_pointer].in_use || cache[clock_pointer].pinned)
         continue;
       // Skip accessed
       if (cache[clock_pointer].access)
@@ -200,10 +235,12 @@ write_behind (void)
 {
   while (!is_closing)
     {
+      // group commit of the metadata logged since the last round
+      journal_commit ();
       lock_acquire (&buffer_cache_lock);
       for (int i = 0; i < BUFFER_CACHE_SIZE; i++)
         {
-          if (cache[i].in_use && cache[i].dirty)
+          if (cache[i].in_use && cache[i].dirty && !cache[i].pinned)
             {
               block_write (fs_device, cache[i].sector, cache[i].buffer);
               // clear the dirty state
@@ -10,6 +10,7 @@ struct buffer_cache_node
   bool dirty;                        // dirty bit
   bool access;                       // access bit for the clock eviction
   bool in_use;                       // if this cache node is in use.
+  bool pinned; // logged metadata, kept off the disk until committed
 };
 
 void buffer_cache_init (void);
@@ -19,6 +20,9 @@ void buffer_cache_read (block_sector_t sector, void *dest, off_t offset,
                         off_t length);
 void buffer_cache_write (block_sector_t sector, const void *src, off_t offset,
                          off_t length);
+void buffer_cache_write_meta (block_sector_t sector, const void *src,
+                              off_t offset, off_t length);
+void buffer_cache_unpin (block_sector_t sector);
 void buffer_cache_close (void);
 
 void buffer_cache_prefetch (block_sector_t sector);
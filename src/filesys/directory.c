@@ -3,6 +3,7 @@
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 #include "threads/thread.h"
+#include <hash.h>
 #include <list.h>
 #include <stdio.h>
 #include <string.h>
@@ -216,6 +217,128 @@ done:
   return success;
 }
 
+/* One name of a dir_add_batch() call, hashed by name. */
+struct batch_name
+{
+  const char *name;      /* Name to add. */
+  size_t idx;            /* Index of the name in the batch. */
+  struct hash_elem elem; /* Element in the batch hash table. */
+};
+
+static unsigned
+batch_name_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_string (hash_entry (e, struct batch_name, elem)->name);
+}
+
+static bool
+batch_name_less (const struct hash_elem *a, const struct hash_elem *b,
+                 void *aux UNUSED)
+{
+  return strcmp (hash_entry (a, struct batch_name, elem)->name,
+                 hash_entry (b, struct batch_name, elem)->name)
+         < 0;
+}
+
+/* Adds the CNT files named NAMES[] to DIR, whose inodes are in
+   SECTORS[].  Unlike CNT calls to dir_add(), the directory is
+   scanned only once, both for names already in use and for free
+   slots, and the entries that do not fit in a free slot are
+   appended with a single write.
+   Entries are added in order up to, but not including, the
+   first name that is invalid, already in DIR or repeated earlier
+   in NAMES.  Returns the number of entries added. */
+size_t
+dir_add_batch (struct dir *dir, const char *const names[],
+               const block_sector_t sectors[], size_t cnt)
+{
+  struct batch_name *batch = NULL;
+  struct dir_entry *tail = NULL;
+  off_t *free_ofs = NULL;
+  struct hash names_hash;
+  struct dir_entry e;
+  size_t added = 0, free_cnt = 0, ok_cnt, i;
+  off_t ofs;
+
+  ASSERT (dir != NULL);
+
+  if (cnt == 0)
+    return 0;
+  batch = malloc (cnt * sizeof *batch);
+  free_ofs = malloc (cnt * sizeof *free_ofs);
+  if (batch == NULL || free_ofs == NULL
+      || !hash_init (&names_hash, batch_name_hash, batch_name_less, NULL))
+    goto done;
+
+  /* Index the valid prefix of NAMES, stopping at a duplicate. */
+  for (ok_cnt = 0; ok_cnt < cnt; ok_cnt++)
+    {
+      const char *name = names[ok_cnt];
+      if (*name == '\0' || strlen (name) > NAME_MAX)
+        break;
+      batch[ok_cnt].name = name;
+      batch[ok_cnt].idx = ok_cnt;
+      if (hash_insert (&names_hash, &batch[ok_cnt].elem) != NULL)
+        break;
+    }
+
+  /* One pass over DIR: cut the batch at the first name in use and
+     remember free slots for the names that remain. */
+  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+       ofs += sizeof e)
+    if (e.in_use)
+      {
+        struct batch_name key;
+        struct hash_elem *found;
+        key.name = e.name;
+        found = hash_find (&names_hash, &key.elem);
+        if (found != NULL)
+          {
+            size_t idx = hash_entry (found, struct batch_name, elem)->idx;
+            if (idx < ok_cnt)
+              ok_cnt = idx;
+          }
+      }
+    else if (free_cnt < cnt)
+      free_ofs[free_cnt++] = ofs;
+  hash_destroy (&names_hash, NULL);
+
+  /* Fill free slots first. */
+  e.in_use = true;
+  for (; added < ok_cnt && added < free_cnt; added++)
+    {
+      strlcpy (e.name, names[added], sizeof e.name);
+      e.inode_sector = sectors[added];
+      if (inode_write_at (dir->inode, &e, sizeof e, free_ofs[added])
+          != sizeof e)
+        goto done;
+    }
+
+  /* Append the rest at end of file in one write. */
+  if (added < ok_cnt)
+    {
+      size_t tail_cnt = ok_cnt - added;
+      off_t tail_size = tail_cnt * sizeof *tail;
+      tail = calloc (tail_cnt, sizeof *tail);
+      if (tail == NULL)
+        goto done;
+      for (i = 0; i < tail_cnt; i++)
+        {
+          tail[i].in_use = true;
+          strlcpy (tail[i].name, names[added + i], sizeof tail[i].name);
+          tail[i].inode_sector = sectors[added + i];
+        }
+      if (inode_write_at (dir->inode, tail, tail_size, ofs) == tail_size)
+        added = ok_cnt;
+    }
+
+done:
+  free (tail);
+  free (free_ofs);
+  free (batch);
+  return added;
+}
+
 /* Removes any entry for NAME in DIR.
    Returns true if successful, false on failure,
    which occurs only if there is no file with the given NAME. */
@@ -30,6 +30,8 @@ struct inode *dir_get_inode (struct dir *);
 /* Reading and writing. */
 bool dir_lookup (const struct dir *, const char *name, struct inode **);
 bool dir_add (struct dir *, const char *name, block_sector_t);
+size_t dir_add_batch (struct dir *, const char *const names[],
+                      const block_sector_t sectors[], size_t cnt);
 bool dir_remove (struct dir *, const char *name);
 bool dir_readdir (struct dir *, char name[NAME_MAX + 1]);
 
@@ -1,6 +1,8 @@
 #include "filesys/file.h"
 #include "filesys/inode.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/thread.h"
 #include <debug.h>
 
 /* An open file. */
@@ -70,6 +72,7 @@ file_read (struct file *file, void *buffer, off_t size)
 {
   off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
   file->pos += bytes_read;
+  file_charge (&thread_current ()->rusage.bytes_read, bytes_read);
   return bytes_read;
 }
 
@@ -81,7 +84,9 @@ file_read (struct file *file, void *buffer, off_t size)
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 {
-  return inode_read_at (file->inode, buffer, size, file_ofs);
+  off_t bytes_read = inode_read_at (file->inode, buffer, size, file_ofs);
+  file_charge (&thread_current ()->rusage.bytes_read, bytes_read);
+  return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into FILE,
@@ -89,13 +94,16 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
    Returns the number of bytes actually written,
    which may be less than SIZE if end of file is reached.
    (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
-   Advances FILE's position by the number of bytes read. */
+   not yet implemented.)  Returns -1 if the disk is full before
+   any byte is written.
+   Advances FILE's position by the number of bytes written. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size)
 {
   off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
-  file->pos += bytes_written;
+  if (bytes_written > 0)
+    file->pos += bytes_written;
+  file_charge (&thread_current ()->rusage.bytes_written, bytes_written);
   return bytes_written;
 }
 
@@ -110,7 +118,24 @@ off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
                off_t file_ofs)
 {
-  return inode_write_at (file->inode, buffer, size, file_ofs);
+  off_t bytes_written = inode_write_at (file->inode, buffer, size, file_ofs);
+  file_charge (&thread_current ()->rusage.bytes_written, bytes_written);
+  return bytes_written;
+}
+
+/* Adds BYTES, unless it is -1 for a failed write, to COUNTER, a
+   process's count of bytes read or written.  Asynchronous I/O
+   workers charge a process from their own threads, so the 64-bit
+   sum is updated with interrupts off. */
+void
+file_charge (uint64_t *counter, off_t bytes)
+{
+  if (bytes > 0)
+    {
+      enum intr_level old_level = intr_disable ();
+      *counter += bytes;
+      intr_set_level (old_level);
+    }
 }
 
 /* Prevents write operations on FILE's underlying inode
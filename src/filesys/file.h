@@ -2,6 +2,7 @@
 #define FILESYS_FILE_H
 
 #include "filesys/off_t.h"
+#include <stdint.h>
 
 struct inode;
 
@@ -16,6 +17,7 @@ off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
+void file_charge (uint64_t *counter, off_t);
 
 /* Preventing writes. */
 void file_deny_write (struct file *);
@@ -4,6 +4,8 @@
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include <debug.h>
@@ -17,6 +19,9 @@ struct lock fs_lock;
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* Root directory inode, open while the file system is mounted. */
+static struct inode *root_inode;
+
 static void do_format (void);
 
 /* Initializes the file system module.
@@ -24,12 +29,14 @@ static void do_format (void);
 void
 filesys_init (bool format)
 {
-  buffer_cache_init ();
-
   fs_device = block_get_role (BLOCK_FILESYS);
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  // replay the journal before anything reads metadata
+  journal_init (format);
+  buffer_cache_init ();
+
   lock_init (&fs_lock);
 
   inode_init ();
@@ -39,6 +46,10 @@ filesys_init (bool format)
     do_format ();
 
   free_map_open ();
+  // keep the root directory's inode in memory for path lookups
+  root_inode = inode_open (ROOT_DIR_SECTOR);
+  if (root_inode == NULL)
+    PANIC ("can't open root directory");
 }
 
 /* Shuts down the file system module, writing any unwritten data
@@ -46,9 +57,14 @@ filesys_init (bool format)
 void
 filesys_done (void)
 {
+  inode_close (root_inode);
+  journal_commit ();
   buffer_cache_close ();
   free_map_close ();
   buffer_cache_close ();
+  // every committed sector is home now
+  journal_done ();
+  free_map_done ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -70,16 +86,37 @@ filesys_create (const char *name, off_t initial_size, bool is_dir)
       return false;
     }
 
+  // a file is created empty, then grown to INITIAL_SIZE a journal
+  // operation at a time, since a large one would not fit in one
+  journal_begin ();
   lock_acquire (&fs_lock);
   block_sector_t inode_sector = 0;
   struct dir *dir = dir_open_path (path);
   bool success = (dir != NULL && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size, is_dir,
+                  && inode_create (inode_sector, is_dir ? initial_size : 0,
+                                   is_dir,
                                    inode_get_inumber (dir_get_inode (dir)))
                   && dir_add (dir, newname, inode_sector));
   if (!success && inode_sector != 0)
     free_map_release (inode_sector, 1);
   lock_release (&fs_lock);
+  journal_end ();
+
+  if (success && !is_dir && initial_size > 0)
+    {
+      struct inode *inode = inode_open (inode_sector);
+      success = inode != NULL && inode_grow (inode, initial_size);
+      if (!success)
+        {
+          journal_begin ();
+          lock_acquire (&fs_lock);
+          dir_remove (dir, newname);
+          lock_release (&fs_lock);
+          journal_end ();
+        }
+      // frees the sectors if removed
+      inode_close (inode);
+    }
 
   dir_close (dir);
   free (path);
@@ -87,6 +124,77 @@ filesys_create (const char *name, off_t initial_size, bool is_dir)
   return success;
 }
 
+/* Number of files filesys_create_batch() creates per journal
+   transaction, small enough for their inodes, directory entries
+   and free map sectors to fit one operation's reservation (see
+   JOURNAL_OP_SECTORS). */
+#define CREATE_BATCH_CHUNK 4
+
+static size_t create_batch_chunk (struct dir *dir, const char *const names[],
+                                  size_t cnt);
+
+/* Creates CNT empty files named NAMES[] in DIR, for callers that
+   populate a directory in bulk.  Every CREATE_BATCH_CHUNK files
+   share one file system lock hold, one scan and extension of the
+   directory, one free map write and one journal transaction.
+   Files are created in order up to the first name that cannot
+   be created (see dir_add_batch()).  Returns the number of files
+   created. */
+size_t
+filesys_create_batch (struct dir *dir, const char *const names[], size_t cnt)
+{
+  size_t created = 0;
+  while (created < cnt)
+    {
+      size_t chunk = cnt - created;
+      if (chunk > CREATE_BATCH_CHUNK)
+        chunk = CREATE_BATCH_CHUNK;
+      size_t done = create_batch_chunk (dir, names + created, chunk);
+      created += done;
+      if (done < chunk)
+        break;
+    }
+  return created;
+}
+
+/* Creates up to CREATE_BATCH_CHUNK files for
+   filesys_create_batch() in one journal transaction. */
+static size_t
+create_batch_chunk (struct dir *dir, const char *const names[], size_t cnt)
+{
+  block_sector_t dir_sector = inode_get_inumber (dir_get_inode (dir));
+  block_sector_t sectors[CREATE_BATCH_CHUNK];
+  size_t allocated = 0, created, i;
+
+  ASSERT (cnt <= CREATE_BATCH_CHUNK);
+
+  journal_begin ();
+  lock_acquire (&fs_lock);
+  free_map_batch_begin ();
+  for (; allocated < cnt; allocated++)
+    {
+      const char *name = names[allocated];
+      if (strchr (name, '/') != NULL || !strcmp (name, ".")
+          || !strcmp (name, "..")
+          || !free_map_allocate (1, &sectors[allocated]))
+        break;
+      if (!inode_create (sectors[allocated], 0, false, dir_sector))
+        {
+          free_map_release (sectors[allocated], 1);
+          break;
+        }
+    }
+  created = dir_add_batch (dir, names, sectors, allocated);
+  // sectors of names that were not added go back to the free map
+  for (i = created; i < allocated; i++)
+    free_map_release (sectors[i], 1);
+  free_map_batch_end ();
+  lock_release (&fs_lock);
+  journal_end ();
+
+  return created;
+}
+
 /* Test if the path is a normal file or a directory
  */
 bool
@@ -114,7 +222,9 @@ filesys_open (const char *name)
   char *filename = (char *)malloc (sizeof (char) * strlen (name) + 1);
   parse_path (name, path, filename);
 
-  // open the directory.
+  // open the directory.  Closing the directories on the way may
+  // free a removed one, which takes a journal operation.
+  journal_begin ();
   lock_acquire (&fs_lock);
   struct dir *dir = dir_open_path (path);
   lock_release (&fs_lock);
@@ -122,6 +232,7 @@ filesys_open (const char *name)
   if (dir != NULL)
     dir_lookup (dir, filename, &inode);
   dir_close (dir);
+  journal_end ();
 
   free (path);
   free (filename);
@@ -141,11 +252,13 @@ filesys_remove (const char *name)
   char *filename = (char *)malloc (sizeof (char) * strlen (name) + 1);
   parse_path (name, path, filename);
 
+  journal_begin ();
   lock_acquire (&fs_lock);
   struct dir *dir = dir_open_path (path);
   bool success = dir != NULL && dir_remove (dir, filename);
   dir_close (dir);
   lock_release (&fs_lock);
+  journal_end ();
 
   free (path);
   free (filename);
@@ -183,10 +296,12 @@ static void
 do_format (void)
 {
   printf ("Formatting file system...");
+  journal_begin ();
   free_map_create ();
   if (!dir_create (ROOT_DIR_SECTOR, 16, ROOT_DIR_SECTOR))
     PANIC ("root directory creation failed");
   free_map_close ();
+  journal_end ();
   printf ("done.\n");
 }
 
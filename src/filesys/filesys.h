@@ -2,12 +2,16 @@
 #define FILESYS_FILESYS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "filesys/off_t.h"
 
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0 /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1 /* Root directory file inode sector. */
+#define SUPER_SECTOR 2    /* Superblock sector, see free-map.c. */
+
+struct dir;
 
 /* Block device that contains the file system. */
 extern struct block *fs_device;
@@ -15,6 +19,8 @@ extern struct block *fs_device;
 void filesys_init (bool format);
 void filesys_done (void);
 bool filesys_create (const char *name, off_t initial_size, bool is_dir);
+size_t filesys_create_batch (struct dir *dir, const char *const names[],
+                             size_t cnt);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
 bool filesys_mkdir (const char *name);
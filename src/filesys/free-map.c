@@ -2,11 +2,60 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* The free map is split into at most SUPER_GROUPS groups of
+   consecutive sectors.  The superblock records how many sectors
+   of each group are free, so that a file system that was
+   unmounted cleanly mounts without reading the free map file: a
+   group's bits are read the first time the group is used. */
+#define SUPER_GROUPS 64
+
+/* Identifies a superblock. */
+#define SUPER_MAGIC 0x53555052
+
+/* On-disk superblock.  Must be exactly BLOCK_SECTOR_SIZE bytes
+   long. */
+struct superblock
+{
+  unsigned magic;                     /* Magic number. */
+  uint32_t clean;                     /* Unmounted cleanly? */
+  uint32_t sector_cnt;                /* Sectors in the file system. */
+  uint32_t free_cnt;                  /* Free sectors. */
+  uint32_t group_size;                /* Sectors per group. */
+  uint32_t group_free[SUPER_GROUPS];  /* Free sectors in each group. */
+  char pad[BLOCK_SECTOR_SIZE - 20 - SUPER_GROUPS * sizeof (uint32_t)];
+};
 
 static struct file *free_map_file; /* Free map file. */
 static struct bitmap *free_map;    /* Free map, one bit per sector. */
+static int batch_depth;            /* Nesting of free_map_batch_begin(). */
+static bool batch_dirty;           /* Free map changed during a batch. */
+
+static struct superblock super;      /* In-memory superblock. */
+static size_t group_cnt;             /* Number of groups in use. */
+static bool loaded[SUPER_GROUPS];    /* Group's bits read from disk? */
+static bool dirty[SUPER_GROUPS];     /* Group's bits not yet written? */
+
+static bool free_map_sync (void);
+static void load_group (size_t group);
+static void account (block_sector_t, size_t cnt, bool allocated);
+static void recount (void);
+static void write_super (bool clean);
+
+/* Returns the number of sectors in GROUP. */
+static size_t
+group_sectors (size_t group)
+{
+  size_t start = group * super.group_size;
+  size_t end = start + super.group_size;
+  return (end < super.sector_cnt ? end : super.sector_cnt) - start;
+}
 
 /* Initializes the free map. */
 void
@@ -17,6 +66,17 @@ free_map_init (void)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_mark (free_map, SUPER_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+
+  ASSERT (sizeof super == BLOCK_SECTOR_SIZE);
+  super.magic = SUPER_MAGIC;
+  super.sector_cnt = bitmap_size (free_map);
+  // whole bitmap elements per group, see bitmap_read_range()
+  super.group_size = ROUND_UP (DIV_ROUND_UP (super.sector_cnt, SUPER_GROUPS),
+                               64);
+  group_cnt = DIV_ROUND_UP (super.sector_cnt, super.group_size);
+  recount ();
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -27,12 +87,37 @@ free_map_init (void)
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  block_sector_t sector = BITMAP_ERROR;
+  size_t group;
+
+  if (cnt == 1)
+    {
+      /* The first free sector is in the first group with any. */
+      for (group = 0; group < group_cnt; group++)
+        if (super.group_free[group] > 0)
+          {
+            load_group (group);
+            sector = bitmap_scan_and_flip (
+                free_map, group * super.group_size, 1, false);
+            break;
+          }
+    }
+  else
+    {
+      for (group = 0; group < group_cnt; group++)
+        load_group (group);
+      sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+    }
+
+  if (sector != BITMAP_ERROR)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false);
-      sector = BITMAP_ERROR;
+      account (sector, cnt, true);
+      if (!free_map_sync ())
+        {
+          bitmap_set_multiple (free_map, sector, cnt, false);
+          account (sector, cnt, false);
+          sector = BITMAP_ERROR;
+        }
     }
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
@@ -43,27 +128,153 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  size_t group;
+  for (group = sector / super.group_size;
+       group <= (sector + cnt - 1) / super.group_size; group++)
+    load_group (group);
   ASSERT (bitmap_all (free_map, sector, cnt));
+  for (size_t i = 0; i < cnt; i++)
+    journal_revoke (sector + i);
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  account (sector, cnt, false);
+  free_map_sync ();
 }
 
-/* Opens the free map file and reads it from disk. */
+/* Reads GROUP's bits from the free map file, unless they have
+   been read already. */
+static void
+load_group (size_t group)
+{
+  if (loaded[group])
+    return;
+  if (!bitmap_read_range (free_map, free_map_file, group * super.group_size,
+                          group_sectors (group)))
+    PANIC ("can't read free map");
+  loaded[group] = true;
+}
+
+/* Updates the free counts for CNT sectors starting at SECTOR
+   becoming ALLOCATED or free, and marks their groups dirty. */
+static void
+account (block_sector_t sector, size_t cnt, bool allocated)
+{
+  for (size_t i = 0; i < cnt; i++)
+    {
+      size_t group = (sector + i) / super.group_size;
+      if (allocated)
+        super.group_free[group]--;
+      else
+        super.group_free[group]++;
+      dirty[group] = true;
+    }
+  if (allocated)
+    super.free_cnt -= cnt;
+  else
+    super.free_cnt += cnt;
+}
+
+/* Starts a batch of allocations and releases.  Until the
+   matching free_map_batch_end(), changes are only made to the
+   in-memory free map, so that a batch writes the free map file
+   once instead of once per call.  Batches may nest. */
+void
+free_map_batch_begin (void)
+{
+  batch_depth++;
+}
+
+/* Ends a batch started by free_map_batch_begin(), writing the
+   free map file if the outermost batch changed it. */
+void
+free_map_batch_end (void)
+{
+  ASSERT (batch_depth > 0);
+  if (--batch_depth == 0 && batch_dirty)
+    {
+      batch_dirty = false;
+      free_map_sync ();
+    }
+}
+
+/* Writes the dirty groups of the free map file, unless a batch
+   is in progress.  Returns false if the write failed. */
+static bool
+free_map_sync (void)
+{
+  bool success = true;
+
+  if (batch_depth > 0)
+    {
+      batch_dirty = true;
+      return true;
+    }
+  if (free_map_file == NULL)
+    return true;
+  for (size_t group = 0; group < group_cnt; group++)
+    if (dirty[group])
+      {
+        ASSERT (loaded[group]);
+        if (bitmap_write_range (free_map, free_map_file,
+                                group * super.group_size,
+                                group_sectors (group)))
+          dirty[group] = false;
+        else
+          success = false;
+      }
+  return success;
+}
+
+/* Opens the free map file.  If the file system was unmounted
+   cleanly, takes the free counts from the superblock and reads
+   the free map lazily; otherwise reads the whole free map and
+   recounts.  Then marks the file system as mounted. */
 void
 free_map_open (void)
 {
+  struct superblock disk;
+
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
-  if (!bitmap_read (free_map, free_map_file))
-    PANIC ("can't read free map");
+
+  block_read (fs_device, SUPER_SECTOR, &disk);
+  if (disk.magic != SUPER_MAGIC)
+    PANIC ("file system has no superblock, reformat it with -f");
+  if (disk.clean && disk.sector_cnt == super.sector_cnt
+      && disk.group_size == super.group_size)
+    {
+      super = disk;
+      for (size_t group = 0; group < group_cnt; group++)
+        loaded[group] = false;
+    }
+  else
+    {
+      printf ("File system was not unmounted cleanly, scanning free map...");
+      if (!bitmap_read (free_map, free_map_file))
+        PANIC ("can't read free map");
+      recount ();
+      printf ("done.\n");
+    }
+  write_super (false);
 }
 
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void)
 {
+  if (!free_map_sync ())
+    PANIC ("can't write free map");
   file_close (free_map_file);
+  free_map_file = NULL;
+}
+
+/* Marks the file system as cleanly unmounted, recording the free
+   counts in the superblock.  Call once every sector, including
+   the free map's, has been written home. */
+void
+free_map_done (void)
+{
+  write_super (true);
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -71,6 +282,8 @@ free_map_close (void)
 void
 free_map_create (void)
 {
+  size_t group;
+
   /* Create inode. */
   if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map), false,
                      FREE_MAP_SECTOR))
@@ -82,4 +295,31 @@ free_map_create (void)
     PANIC ("can't open free map");
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
+
+  for (group = 0; group < group_cnt; group++)
+    dirty[group] = false;
+  write_super (true);
+}
+
+/* Counts the free sectors of each group in the in-memory free
+   map, all of which must be up to date. */
+static void
+recount (void)
+{
+  super.free_cnt = 0;
+  for (size_t group = 0; group < group_cnt; group++)
+    {
+      super.group_free[group] = bitmap_count (
+          free_map, group * super.group_size, group_sectors (group), false);
+      super.free_cnt += super.group_free[group];
+      loaded[group] = true;
+    }
+}
+
+/* Writes the superblock with the given CLEAN flag. */
+static void
+write_super (bool clean)
+{
+  super.clean = clean;
+  block_write (fs_device, SUPER_SECTOR, &super);
 }
@@ -10,8 +10,12 @@ void free_map_read (void);
 void free_map_create (void);
 void free_map_open (void);
 void free_map_close (void);
+void free_map_done (void);
 
 bool free_map_allocate (size_t, block_sector_t *);
 void free_map_release (block_sector_t, size_t);
 
+void free_map_batch_begin (void);
+void free_map_batch_end (void);
+
 #endif /* filesys/free-map.h */
@@ -2,6 +2,8 @@
 #include "buffer_cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
 #include <debug.h>
@@ -27,11 +29,16 @@ typedef uint16_t fs_sec_t;
 #define ERR_SECTOR ((fs_sec_t)(-1))
 #define INDIRECT_COUNT (FS_SECTORS / PTR_PER_SEC)
 
+/* Most bytes written to, or added to, a file in one journal
+   operation: the indirect blocks allocated for them, the inode
+   and the free map sectors fit JOURNAL_OP_SECTORS. */
+#define WRITE_CHUNK ((off_t)(4 * PTR_PER_SEC * BLOCK_SECTOR_SIZE))
+
 // disk freemap managament helper functions
-static fs_sec_t allocate_sector (void);
+static fs_sec_t allocate_sector (bool);
 static void release_sector (fs_sec_t);
-static fs_sec_t allocate_indirect (fs_sec_t);
-static void release_indirect (fs_sec_t, fs_sec_t);
+static fs_sec_t allocate_indirect (fs_sec_t, bool);
+static void release_indirect (fs_sec_t);
 
 /* On-disk indirect block layout: index 256 data sectors */
 struct indirect_block
@@ -49,16 +56,21 @@ struct inode_disk
   bool isdir;      /* True if the inode file is a directory. */
   fs_sec_t pardir; /* The directory inode number in which this file resides */
   unsigned magic;  /* Magic number. */
+  unsigned version; /* See inode_version(); 0 if never set. */
   char pad[PAD_LEN]; /* make sure the disk inode is big enough */
 };
 
 // read from disk helper functions
+static unsigned next_version (void);
+static void note_version (unsigned);
+
 static void load_inode (struct inode_disk *, fs_sec_t);
 static void load_indirect (struct indirect_block *, fs_sec_t);
 // write back to disk helper functions
 static void wb_inode (const struct inode_disk *, fs_sec_t);
 static void wb_indirect (const struct indirect_block *, fs_sec_t);
 static void wb_data (const void *, fs_sec_t);
+static void wb_meta (const void *, fs_sec_t, off_t, off_t);
 
 /* Returns the number of sectors to allocate for an inode SIZE
    bytes long. */
@@ -68,28 +80,41 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
 }
 
-/* In-memory inode. */
+/* In-memory inode.
+
+   RW guards LENGTH and DENY_WRITE_CNT: readers and writers inside
+   the file hold it shared, and a writer extending the file takes
+   it exclusively only to publish the new length, after the new
+   sectors are allocated and written.  GROW serializes extending
+   writers; it is taken before RW. */
 struct inode
 {
   struct list_elem elem;  /* Element in inode list. */
-  struct lock mutex;      /* for synchronization */
+  struct rwlock rw;       /* Guards length and deny_write_cnt. */
+  struct lock grow;       /* Held while extending the file. */
   block_sector_t sector;  /* Sector number of disk location. */
   int open_cnt;           /* Number of openers. */
   bool removed;           /* True if deleted, false otherwise. */
   int deny_write_cnt;     /* 0: writes ok, >0: deny writes. */
+  bool version_dirty;     /* Version changed since written back. */
   struct inode_disk data; /* Inode content. */
 };
 
-/* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+/* Returns true if the contents of INODE are file system metadata,
+   which goes through the journal: directories and the free map. */
+static inline bool
+inode_is_meta (const struct inode *inode)
+{
+  return inode->data.isdir || inode->sector == FREE_MAP_SECTOR;
+}
+
+/* Returns the block device sector that holds byte offset POS
+   within INODE, which must have been allocated, even if it lies
+   beyond the length readers see so far. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos)
+lookup_sector (const struct inode *inode, off_t pos)
 {
   ASSERT (inode != NULL);
-  if (pos >= inode_length (inode))
-    return -1;
   // index calculation
   ASSERT ((pos / BLOCK_SECTOR_SIZE) < FS_SECTORS)
   fs_sec_t sec_off = (fs_sec_t)(pos / BLOCK_SECTOR_SIZE);
@@ -104,6 +129,19 @@ byte_to_sector (const struct inode *inode, off_t pos)
   return (block_sector_t)ind_data.data_sectors[ind_idx];
 }
 
+/* Returns the block device sector that contains byte offset POS
+   within INODE.
+   Returns -1 if INODE does not contain data for a byte at offset
+   POS.  The caller must hold INODE->rw. */
+static block_sector_t
+byte_to_sector (const struct inode *inode, off_t pos)
+{
+  ASSERT (inode != NULL);
+  if (pos >= inode->data.length)
+    return -1;
+  return lookup_sector (inode, pos);
+}
+
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
@@ -124,17 +162,21 @@ inode_opencnt (const struct inode *inode)
 }
 
 /* Get a free sector and zero it, return the sector index.
+   The zeroing is journaled if META is true.
    Return ERR_SECTOR on error
 */
 static fs_sec_t
-allocate_sector ()
+allocate_sector (bool meta)
 {
   block_sector_t sec32 = 0;
   if (!free_map_allocate (1, &sec32))
     return ERR_SECTOR;
   fs_sec_t sec = (fs_sec_t)sec32;
   // fill with zero
-  wb_data (zeros, sec);
+  if (meta)
+    wb_meta (zeros, sec, 0, BLOCK_SECTOR_SIZE);
+  else
+    wb_data (zeros, sec);
   return sec;
 }
 /* Free one disk sector */
@@ -145,15 +187,16 @@ release_sector (fs_sec_t sec)
 }
 
 /* Allocate a indirect block on the disk,
-   with data_blks underlying data blocks.
+   with data_blks underlying data blocks, which hold metadata if
+   META is true.
    Return the sector index of the indirect block.
    Return ERR_SECTOR on error.
 */
 static fs_sec_t
-allocate_indirect (fs_sec_t data_blks)
+allocate_indirect (fs_sec_t data_blks, bool meta)
 {
   ASSERT (data_blks <= PTR_PER_SEC);
-  fs_sec_t ind_sec = allocate_sector ();
+  fs_sec_t ind_sec = allocate_sector (true);
   // error: can not allocate the indirect block
   if (ind_sec == ERR_SECTOR)
     return ERR_SECTOR;
@@ -163,7 +206,7 @@ allocate_indirect (fs_sec_t data_blks)
     ind_blk.data_sectors[i] = ERR_SECTOR;
   for (fs_sec_t i = 0; i < data_blks; i++)
     {
-      fs_sec_t sec = allocate_sector ();
+      fs_sec_t sec = allocate_sector (meta);
       // no more space:
       // 1. release previously allocated data blocks
       // 2. also release the indirect data block
@@ -182,14 +225,16 @@ allocate_indirect (fs_sec_t data_blks)
 }
 
 /* release a indirect block on the disk,
-   with data_blks underlying data blocks */
+   with every data block allocated under it, including those
+   past the end of the file left by an extension that failed */
 static void
-release_indirect (fs_sec_t ind_sec, fs_sec_t data_blks)
+release_indirect (fs_sec_t ind_sec)
 {
   struct indirect_block ind_blk;
   load_indirect (&ind_blk, ind_sec);
-  for (fs_sec_t i = 0; i < data_blks; i++)
-    release_sector (ind_blk.data_sectors[i]);
+  for (fs_sec_t i = 0; i < PTR_PER_SEC; i++)
+    if (ind_blk.data_sectors[i] != ERR_SECTOR)
+      release_sector (ind_blk.data_sectors[i]);
   release_sector (ind_sec);
 }
 
@@ -198,13 +243,16 @@ release_indirect (fs_sec_t ind_sec, fs_sec_t data_blks)
    device.
    Parameter isdir indicate whether this creates a file or a directory.
 
+   LENGTH is at most WRITE_CHUNK, so that the allocation fits one
+   journal operation; a longer file is grown with inode_grow().
+
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
 bool
 inode_create (block_sector_t inode_sector, off_t length, bool isdir,
               block_sector_t pardir_inode)
 {
-  ASSERT (length >= 0);
+  ASSERT (length >= 0 && length <= WRITE_CHUNK);
 
   struct inode_disk disk_inode;
   memset ((void *)&disk_inode, 0, sizeof (struct inode_disk));
@@ -214,20 +262,22 @@ inode_create (block_sector_t inode_sector, off_t length, bool isdir,
   disk_inode.magic = INODE_MAGIC;
   disk_inode.isdir = isdir;
   disk_inode.pardir = pardir_inode;
+  disk_inode.version = next_version ();
 
   // number of required sectors, required indirect blocks
   fs_sec_t sectors = (fs_sec_t)bytes_to_sectors (length);
   fs_sec_t indirects = (fs_sec_t)DIV_ROUND_UP (sectors, PTR_PER_SEC);
+  bool meta = isdir || inode_sector == FREE_MAP_SECTOR;
   // allocate the indirect blocks
   for (fs_sec_t i = 0; i < indirects; i++)
     {
       fs_sec_t data_blks = sectors >= PTR_PER_SEC ? PTR_PER_SEC : sectors;
-      fs_sec_t ind_blk_sec = allocate_indirect (data_blks);
+      fs_sec_t ind_blk_sec = allocate_indirect (data_blks, meta);
       // error: release previously allocated indirect blocks
       if (ind_blk_sec == ERR_SECTOR)
         {
           for (fs_sec_t j = 0; j < i; j++)
-            release_indirect (disk_inode.indirect_blocks[j], PTR_PER_SEC);
+            release_indirect (disk_inode.indirect_blocks[j]);
           return false;
         }
       disk_inode.indirect_blocks[i] = ind_blk_sec;
@@ -267,13 +317,23 @@ inode_open (block_sector_t sector)
     return NULL;
 
   /* Initialize. */
-  lock_init (&inode->mutex);
+  rwlock_init (&inode->rw);
+  lock_init (&inode->grow);
   list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->version_dirty = false;
   load_inode (&inode->data, inode->sector);
+  if (inode->data.version == 0)
+    {
+      // made outside the kernel
+      inode->data.version = next_version ();
+      inode->version_dirty = true;
+    }
+  else
+    note_version (inode->data.version);
   DEBUG_PRINT ("sector %d open_cnt: %d\n", inode->sector, inode->open_cnt);
 
   return inode;
@@ -316,19 +376,21 @@ inode_close (struct inode *inode)
       /* Deallocate blocks if removed. */
       if (inode->removed)
         {
-          // number of data blocks and indirect blocks in the inode
-          fs_sec_t sectors = (fs_sec_t)bytes_to_sectors (inode->data.length);
-          fs_sec_t indirects = (fs_sec_t)DIV_ROUND_UP (sectors, PTR_PER_SEC);
+          journal_begin ();
           // release the indirect block sectors
-          for (fs_sec_t i = 0; i < indirects; i++)
-            {
-              fs_sec_t data_blks
-                  = sectors >= PTR_PER_SEC ? PTR_PER_SEC : sectors;
-              release_indirect (inode->data.indirect_blocks[i], data_blks);
-              sectors -= data_blks;
-            }
+          for (fs_sec_t i = 0; i < INDIRECT_COUNT; i++)
+            if (inode->data.indirect_blocks[i] != ERR_SECTOR)
+              release_indirect (inode->data.indirect_blocks[i]);
           // release the inode block sector
           release_sector (inode->sector);
+          journal_end ();
+        }
+      else if (inode->version_dirty)
+        {
+          // keep the version for the next time INODE is opened
+          journal_begin ();
+          wb_inode (&inode->data, inode->sector);
+          journal_end ();
         }
       free (inode);
     }
@@ -352,11 +414,13 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
 
+  rwlock_acquire_read (&inode->rw);
+  off_t length = inode->data.length;
   while (size > 0)
     {
       /* Bytes left in inode, bytes left in sector, lesser of the
        * two. */
-      off_t inode_left = inode_length (inode) - offset;
+      off_t inode_left = length - offset;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
@@ -371,7 +435,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       buffer_cache_read (sector_idx, buffer + bytes_read, sector_ofs,
                          chunk_size);
       // fetch the next data blocks in this file
-      if (inode->data.length > offset + 512)
+      if (length > offset + 512)
         buffer_cache_prefetch (byte_to_sector (inode, offset + 512));
 
       /* Advance. */
@@ -379,105 +443,224 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  rwlock_release_read (&inode->rw);
 
   return bytes_read;
 }
 
-/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
-   Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
-off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
-                off_t offset)
+/* Allocates the sectors of INODE from byte LENGTH, its current
+   length, up to byte END.  Returns false if the disk is full; the
+   sectors allocated so far stay in INODE's indirect blocks, past
+   its length, and are reused by the next extension.  The caller
+   must hold INODE->grow. */
+static bool
+extend (struct inode *inode, off_t length, off_t end)
 {
-  const uint8_t *buffer = buffer_;
-  off_t bytes_written = 0;
-
-  if (inode->deny_write_cnt)
-    return 0;
-
-  lock_acquire (&inode->mutex);
-  // extend the file
-  if (offset + size > inode_length (inode))
+  for (off_t i = length; i < end;
+       i += BLOCK_SECTOR_SIZE - i % BLOCK_SECTOR_SIZE)
     {
-      for (off_t i = inode_length (inode); i < offset + size; i++)
+      fs_sec_t sec_off = (fs_sec_t)(i / BLOCK_SECTOR_SIZE);
+      fs_sec_t ind_blk = sec_off / PTR_PER_SEC;
+      fs_sec_t ind_idx = sec_off % PTR_PER_SEC;
+      // new indirect block is required
+      if (inode->data.indirect_blocks[ind_blk] == ERR_SECTOR)
         {
-          fs_sec_t sec_off = (fs_sec_t)(i / BLOCK_SECTOR_SIZE);
-          fs_sec_t ind_blk = sec_off / PTR_PER_SEC;
-          fs_sec_t ind_idx = sec_off % PTR_PER_SEC;
-          // new indirect block is required
-          if (inode->data.indirect_blocks[ind_blk] == ERR_SECTOR)
-            {
-              fs_sec_t ind_sec = allocate_indirect (1);
-              // FIXME - what to do if we cannot further extend the
-              // file
-              inode->data.indirect_blocks[ind_blk] = ind_sec;
-            }
+          fs_sec_t ind_sec = allocate_indirect (1, inode_is_meta (inode));
+          if (ind_sec == ERR_SECTOR)
+            return false;
+          inode->data.indirect_blocks[ind_blk] = ind_sec;
+        }
 
-          struct indirect_block ind_data;
-          load_indirect (&ind_data, inode->data.indirect_blocks[ind_blk]);
-          // new data block is required
-          if (ind_data.data_sectors[ind_idx] == ERR_SECTOR)
+      struct indirect_block ind_data;
+      load_indirect (&ind_data, inode->data.indirect_blocks[ind_blk]);
+      // new data block is required
+      if (ind_data.data_sectors[ind_idx] == ERR_SECTOR)
+        {
+          fs_sec_t data_sec = allocate_sector (inode_is_meta (inode));
+          // cannot extend file, no free space
+          if (data_sec == ERR_SECTOR)
             {
-              fs_sec_t data_sec = allocate_sector ();
-              // cannot extend file, no free space
-              if (data_sec == ERR_SECTOR)
-                {
-                  DEBUG_PRINT ("[FS] cannot extend file, disk is full\n");
-                  lock_release (&inode->mutex);
-                  return -1;
-                }
-              // FIXME - what to do if we cannot further extend the file
-              ind_data.data_sectors[ind_idx] = data_sec;
-              wb_indirect (&ind_data, inode->data.indirect_blocks[ind_blk]);
+              DEBUG_PRINT ("[FS] cannot extend file, disk is full\n");
+              return false;
             }
+          ind_data.data_sectors[ind_idx] = data_sec;
+          wb_indirect (&ind_data, inode->data.indirect_blocks[ind_blk]);
         }
-
-      // update inode metadata
-      inode->data.length = offset + size;
-      wb_inode (&inode->data, inode->sector);
     }
-  lock_release (&inode->mutex);
+  return true;
+}
+
+/* Writes SIZE bytes from BUFFER into the allocated sectors of
+   INODE, starting at OFFSET. */
+static void
+write_sectors (struct inode *inode, const uint8_t *buffer, off_t size,
+               off_t offset)
+{
   while (size > 0)
     {
-      /* Bytes left in inode, bytes left in sector, lesser of the
-       * two. */
-      off_t inode_left = inode_length (inode) - offset;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
 
       /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
-        break;
+      int chunk_size = size < sector_left ? size : sector_left;
 
       /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      block_sector_t sector_idx = lookup_sector (inode, offset);
 
       /* Write the sector to the cache */
-      buffer_cache_write (sector_idx, buffer + bytes_written, sector_ofs,
-                          chunk_size);
+      if (inode_is_meta (inode))
+        wb_meta (buffer, sector_idx, sector_ofs, chunk_size);
+      else
+        buffer_cache_write (sector_idx, buffer, sector_ofs, chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
-      bytes_written += chunk_size;
+      buffer += chunk_size;
     }
+}
 
+/* Writes SIZE bytes, at most WRITE_CHUNK, from BUFFER into INODE
+   in one journal operation, starting at OFFSET, extending INODE
+   if the write ends past its end.  With a null BUFFER, only
+   extends INODE, with zeros.
+   Returns SIZE, or 0 if writes are denied, or -1 if the disk is
+   full.  Readers see the new length only once the data behind it
+   has been written. */
+static off_t
+write_chunk (struct inode *inode, const uint8_t *buffer, off_t size,
+             off_t offset)
+{
+  off_t bytes_written = 0;
+  off_t end = offset + size;
+
+  ASSERT (size <= WRITE_CHUNK);
+
+  journal_begin ();
+  if (end > inode_length (inode))
+    {
+      lock_acquire (&inode->grow);
+      // the read side keeps deny_write out until the data is written
+      rwlock_acquire_read (&inode->rw);
+      off_t length = inode->data.length;
+      // only this thread changes the length while we hold GROW
+      if (inode->deny_write_cnt == 0)
+        {
+          if (end <= length || extend (inode, length, end))
+            {
+              if (buffer != NULL)
+                write_sectors (inode, buffer, size, offset);
+              bytes_written = size;
+            }
+          else
+            bytes_written = -1;
+        }
+      rwlock_release_read (&inode->rw);
+      // a new version only once the data and length are in place, so
+      // nothing read during the write is taken for the new contents
+      if (bytes_written > 0 && end > length)
+        {
+          rwlock_acquire_write (&inode->rw);
+          inode->data.length = end;
+          inode->data.version = next_version ();
+          wb_inode (&inode->data, inode->sector);
+          rwlock_release_write (&inode->rw);
+        }
+      else if (bytes_written > 0 && buffer != NULL)
+        {
+          inode->data.version = next_version ();
+          inode->version_dirty = true;
+        }
+      lock_release (&inode->grow);
+    }
+  else
+    {
+      rwlock_acquire_read (&inode->rw);
+      if (inode->deny_write_cnt == 0)
+        {
+          if (buffer != NULL)
+            {
+              write_sectors (inode, buffer, size, offset);
+              inode->data.version = next_version ();
+              inode->version_dirty = true;
+            }
+          bytes_written = size;
+        }
+      rwlock_release_read (&inode->rw);
+    }
+  journal_end ();
+
+  return bytes_written;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+   extending INODE if the write ends past its end.  A gap between
+   the end of INODE and OFFSET reads as zeros.  A large write takes
+   a journal operation per WRITE_CHUNK bytes, so a crash may leave
+   only part of it done.
+   Returns the number of bytes actually written, which is 0 if
+   writes are denied, or -1 if the disk is full before any byte is
+   written. */
+off_t
+inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+                off_t offset)
+{
+  const uint8_t *buffer = buffer_;
+  off_t bytes_written = 0;
+
+  while (bytes_written < size)
+    {
+      off_t length = inode_length (inode);
+      off_t chunk, n;
+      if (offset > length)
+        {
+          // fill the gap first, nothing is written yet
+          chunk = offset - length < WRITE_CHUNK ? offset - length
+                                                : WRITE_CHUNK;
+          n = write_chunk (inode, NULL, chunk, length);
+          if (n <= 0)
+            return n;
+          continue;
+        }
+      chunk = size - bytes_written < WRITE_CHUNK ? size - bytes_written
+                                                 : WRITE_CHUNK;
+      n = write_chunk (inode, buffer + bytes_written, chunk,
+                       offset + bytes_written);
+      if (n <= 0)
+        return bytes_written > 0 ? bytes_written : n;
+      bytes_written += n;
+    }
   return bytes_written;
 }
 
+/* Extends INODE with zeros to LENGTH bytes, unless it is that long
+   already, a journal operation per WRITE_CHUNK bytes.  Returns
+   false if writes to INODE are denied or the disk is full; INODE
+   may have grown part of the way then. */
+bool
+inode_grow (struct inode *inode, off_t length)
+{
+  off_t cur;
+
+  while ((cur = inode_length (inode)) < length)
+    {
+      off_t chunk = length - cur < WRITE_CHUNK ? length - cur : WRITE_CHUNK;
+      if (write_chunk (inode, NULL, chunk, cur) != chunk)
+        return false;
+    }
+  return true;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
 inode_deny_write (struct inode *inode)
 {
   ASSERT (inode != NULL);
+  rwlock_acquire_write (&inode->rw);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_release_write (&inode->rw);
 }
 
 /* Re-enables writes to INODE.
@@ -487,9 +670,11 @@ void
 inode_allow_write (struct inode *inode)
 {
   ASSERT (inode != NULL);
+  rwlock_acquire_write (&inode->rw);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  rwlock_release_write (&inode->rw);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -497,7 +682,49 @@ off_t
 inode_length (const struct inode *inode)
 {
   ASSERT (inode != NULL);
-  return inode->data.length;
+  struct rwlock *rw = (struct rwlock *)&inode->rw;
+  rwlock_acquire_read (rw);
+  off_t length = inode->data.length;
+  rwlock_release_read (rw);
+  return length;
+}
+
+/* Returns INODE's version, which changes as every write to INODE
+   completes and is kept on disk, so it is the same after INODE is
+   closed and opened again.  A new version is above any version
+   seen since boot, in any inode, so data derived from INODE's
+   contents, read after fetching the version, stays valid while
+   INODE's sector has the same version.  Never 0. */
+unsigned
+inode_version (const struct inode *inode)
+{
+  ASSERT (inode != NULL);
+  return inode->data.version;
+}
+
+/* Last version handed out or found on disk. */
+static unsigned last_version;
+
+/* Returns a version number above any handed out or noted
+   before. */
+static unsigned
+next_version (void)
+{
+  enum intr_level old_level = intr_disable ();
+  unsigned version = ++last_version;
+  intr_set_level (old_level);
+  return version;
+}
+
+/* Notes VERSION, read from disk, so that next_version() does not
+   hand it out again. */
+static void
+note_version (unsigned version)
+{
+  enum intr_level old_level = intr_disable ();
+  if (version > last_version)
+    last_version = version;
+  intr_set_level (old_level);
 }
 
 /* Get the directory inode number in which this file is stored */
@@ -519,13 +746,19 @@ inode_isdir (const struct inode *inode)
 static void
 wb_inode (const struct inode_disk *inode, fs_sec_t sec)
 {
-  buffer_cache_write (sec, (void *)inode, 0, BLOCK_SECTOR_SIZE);
+  wb_meta (inode, sec, 0, BLOCK_SECTOR_SIZE);
 }
 static void
 wb_indirect (const struct indirect_block *ind_blk, fs_sec_t sec_ind)
 {
-  buffer_cache_write (sec_ind, (void *)ind_blk->data_sectors, 0,
-                      BLOCK_SECTOR_SIZE);
+  wb_meta (ind_blk->data_sectors, sec_ind, 0, BLOCK_SECTOR_SIZE);
+}
+/* metadata goes through the journal */
+static void
+wb_meta (const void *data, fs_sec_t sec, off_t ofs, off_t len)
+{
+  buffer_cache_write_meta (sec, data, ofs, len);
+  journal_log (sec);
 }
 static void
 wb_data (const void *data, fs_sec_t sec)
@@ -16,9 +16,11 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+bool inode_grow (struct inode *, off_t length);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+unsigned inode_version (const struct inode *);
 bool inode_isdir (const struct inode *);
 int inode_opencnt (const struct inode *inode);
 
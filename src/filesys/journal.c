@@ -0,0 +1,272 @@
+#include "filesys/journal.h"
+#include "filesys/buffer_cache.h"
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Identifies a journal header. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/* Group commit: once this many sectors wait in the running
+   transaction, the next journal_begin() or the last
+   journal_end() commits them. */
+#define JOURNAL_GROUP 16
+
+/* Most sectors the running transaction holds.  Their buffer cache
+   lines stay pinned, so this is half of the 64-line cache, which
+   always keeps lines to evict. */
+#define JOURNAL_RUNNING_MAX 32
+
+/* Most sectors one operation logs.  The outermost journal_begin()
+   reserves this much room in the running transaction, and waits
+   until it can, so that operations in progress never overflow it.
+   An operation that would log more, such as a large extension of
+   a file, is split into several. */
+#define JOURNAL_OP_SECTORS 16
+
+/* On-disk journal header.  Must be exactly BLOCK_SECTOR_SIZE
+   bytes long. */
+struct journal_header
+{
+  unsigned magic;                     /* Magic number. */
+  uint32_t cnt;                       /* Number of committed records. */
+  block_sector_t home[JOURNAL_SLOTS]; /* Home sector of each record. */
+  char pad[BLOCK_SECTOR_SIZE - 8 - JOURNAL_SLOTS * sizeof (block_sector_t)];
+};
+
+static struct lock journal_lock;
+static struct condition journal_idle; /* An operation ended, or a
+                                         commit finished. */
+static int outstanding;               /* Operations in progress, each
+                                         with JOURNAL_OP_SECTORS
+                                         reserved. */
+static bool committing;               /* A commit is in progress. */
+
+/* Committed records, as last written to disk. */
+static struct journal_header header;
+
+/* Sectors logged since the last commit.  Their buffer cache
+   lines are pinned until they are committed. */
+static block_sector_t running[JOURNAL_RUNNING_MAX];
+static size_t running_cnt;
+
+/* Scratch sector for copying records. */
+static uint8_t record[BLOCK_SECTOR_SIZE];
+
+static void commit_locked (void);
+static void do_commit (void);
+static void replay (void);
+static void write_header (void);
+
+/* Initializes the journal.  If FORMAT is true, writes an empty
+   journal; otherwise replays the records committed before the
+   file system was last shut down (or crashed).
+   Must run before the buffer cache reads any metadata. */
+void
+journal_init (bool format)
+{
+  ASSERT (sizeof header == BLOCK_SECTOR_SIZE);
+
+  lock_init (&journal_lock);
+  cond_init (&journal_idle);
+
+  if (format)
+    {
+      memset (&header, 0, sizeof header);
+      header.magic = JOURNAL_MAGIC;
+      write_header ();
+      return;
+    }
+
+  block_read (fs_device, JOURNAL_SECTOR, &header);
+  if (header.magic != JOURNAL_MAGIC || header.cnt > JOURNAL_SLOTS)
+    PANIC ("file system has no journal, reformat it with -f");
+  if (header.cnt > 0)
+    {
+      printf ("Replaying %u journal records...", header.cnt);
+      replay ();
+      printf ("done.\n");
+    }
+}
+
+/* Commits outstanding metadata and empties the journal.
+   Call after every committed sector has been written home. */
+void
+journal_done (void)
+{
+  lock_acquire (&journal_lock);
+  ASSERT (running_cnt == 0);
+  header.cnt = 0;
+  write_header ();
+  lock_release (&journal_lock);
+}
+
+/* Starts a file system operation, which may log up to
+   JOURNAL_OP_SECTORS sectors.  All metadata the operation logs is
+   committed atomically.  Operations nest; only the outermost
+   begin/end pair of a thread counts.
+   The outermost journal_begin() may block for a commit, so it
+   must be called before taking any file system lock, and so must
+   anything that may close an inode for the last time. */
+void
+journal_begin (void)
+{
+  struct thread *t = thread_current ();
+  if (t->journal_depth++ > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  for (;;)
+    {
+      bool room = (running_cnt + (outstanding + 1) * JOURNAL_OP_SECTORS
+                   <= JOURNAL_RUNNING_MAX);
+      if (room && running_cnt < JOURNAL_GROUP && !committing)
+        break;
+      // wait for a commit, or for the operations in progress to end
+      // within their reservations and commit to make room
+      if (committing || (!room && outstanding > 0))
+        cond_wait (&journal_idle, &journal_lock);
+      else
+        commit_locked ();
+    }
+  outstanding++;
+  lock_release (&journal_lock);
+}
+
+/* Ends a file system operation started by journal_begin(). */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+  ASSERT (t->journal_depth > 0);
+  if (--t->journal_depth > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  if (--outstanding == 0 && running_cnt >= JOURNAL_GROUP && !committing)
+    commit_locked ();
+  cond_broadcast (&journal_idle, &journal_lock);
+  lock_release (&journal_lock);
+}
+
+/* Adds SECTOR, just written to the buffer cache with
+   buffer_cache_write_meta(), to the running transaction.  Must be
+   called inside an operation, whose reservation it uses. */
+void
+journal_log (block_sector_t sector)
+{
+  lock_acquire (&journal_lock);
+  for (size_t i = 0; i < running_cnt; i++)
+    if (running[i] == sector)
+      {
+        lock_release (&journal_lock);
+        return;
+      }
+  ASSERT (running_cnt < JOURNAL_RUNNING_MAX);
+  running[running_cnt++] = sector;
+  lock_release (&journal_lock);
+}
+
+/* Drops SECTOR, which is being freed, from the journal, so that
+   a replay cannot overwrite whatever the sector is reused for.
+   A committed record of SECTOR is dropped by checkpointing the
+   journal at once: writing it home keeps a crash before the free
+   commits from losing the record, and the empty journal on disk
+   keeps a crash after the sector is reused from replaying it. */
+void
+journal_revoke (block_sector_t sector)
+{
+  lock_acquire (&journal_lock);
+  for (size_t i = 0; i < header.cnt; i++)
+    if (header.home[i] == sector)
+      {
+        replay ();
+        break;
+      }
+  for (size_t i = 0; i < running_cnt; i++)
+    if (running[i] == sector)
+      {
+        running[i] = running[--running_cnt];
+        buffer_cache_unpin (sector);
+        break;
+      }
+  lock_release (&journal_lock);
+}
+
+/* Commits the running transaction, waiting for operations in
+   progress to finish.  The caller must not be inside an
+   operation. */
+void
+journal_commit (void)
+{
+  ASSERT (thread_current ()->journal_depth == 0);
+  lock_acquire (&journal_lock);
+  commit_locked ();
+  lock_release (&journal_lock);
+}
+
+/* Commits the running transaction, once the operations in
+   progress end.  New operations wait until the commit is done. */
+static void
+commit_locked (void)
+{
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  while (committing)
+    cond_wait (&journal_idle, &journal_lock);
+  committing = true;
+  while (outstanding > 0)
+    cond_wait (&journal_idle, &journal_lock);
+  do_commit ();
+  committing = false;
+  cond_broadcast (&journal_idle, &journal_lock);
+}
+
+/* Copies the running transaction into the journal, writes the
+   header, then releases the logged sectors to write-behind. */
+static void
+do_commit (void)
+{
+  if (running_cnt == 0)
+    return;
+  if (header.cnt + running_cnt > JOURNAL_SLOTS)
+    replay ();
+
+  for (size_t i = 0; i < running_cnt; i++)
+    {
+      buffer_cache_read (running[i], record, 0, BLOCK_SECTOR_SIZE);
+      block_write (fs_device, JOURNAL_SECTOR + 1 + header.cnt + i, record);
+      header.home[header.cnt + i] = running[i];
+    }
+  header.cnt += running_cnt;
+  // the commit point
+  write_header ();
+
+  for (size_t i = 0; i < running_cnt; i++)
+    buffer_cache_unpin (running[i]);
+  running_cnt = 0;
+}
+
+/* Writes every committed record to its home sector, in commit
+   order, and empties the journal.  Also serves as the checkpoint
+   when the journal fills up or a committed sector is freed. */
+static void
+replay (void)
+{
+  for (size_t i = 0; i < header.cnt; i++)
+    {
+      block_read (fs_device, JOURNAL_SECTOR + 1 + i, record);
+      block_write (fs_device, header.home[i], record);
+    }
+  header.cnt = 0;
+  write_header ();
+}
+
+static void
+write_header (void)
+{
+  block_write (fs_device, JOURNAL_SECTOR, &header);
+}
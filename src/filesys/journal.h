@@ -0,0 +1,31 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include "devices/block.h"
+#include <stdbool.h>
+
+/* Metadata journal.
+
+   Metadata sectors (inodes, indirect blocks, directory contents
+   and the free map) are logged into a fixed region of the file
+   system device before they may reach their home location.  The
+   region is a header sector followed by JOURNAL_SLOTS record
+   sectors; the header write is the commit point. */
+
+/* First sector of the journal region: the journal header. */
+#define JOURNAL_SECTOR 3
+/* Number of record sectors that follow the journal header. */
+#define JOURNAL_SLOTS 64
+/* Number of sectors reserved for the journal region. */
+#define JOURNAL_SECTORS (1 + JOURNAL_SLOTS)
+
+void journal_init (bool format);
+void journal_done (void);
+
+void journal_begin (void);
+void journal_end (void);
+void journal_log (block_sector_t);
+void journal_revoke (block_sector_t);
+void journal_commit (void);
+
+#endif /* filesys/journal.h */
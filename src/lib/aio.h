@@ -0,0 +1,48 @@
+#ifndef __LIB_AIO_H
+#define __LIB_AIO_H
+
+/* Ring shared between a process and the kernel for asynchronous
+   file I/O, set up by aio_setup() and driven by aio_enter().
+
+   The process fills submission entries at SQ_TAIL and advances
+   it; the kernel takes them from SQ_HEAD.  The kernel posts one
+   completion per submission at CQ_TAIL; the process consumes
+   them from CQ_HEAD.  Indexes run freely and are taken modulo
+   AIO_RING_SIZE. */
+
+/* Entries in each half of the ring. */
+#define AIO_RING_SIZE 64
+
+/* Operations. */
+#define AIO_READ 0  /* Like pread(). */
+#define AIO_WRITE 1 /* Like pwrite(). */
+
+/* A request. */
+struct aio_sqe
+{
+  int op;          /* AIO_READ or AIO_WRITE. */
+  int fd;          /* Open file, not the console. */
+  void *buf;       /* Buffer to read into or write from. */
+  unsigned size;   /* Bytes to transfer. */
+  unsigned offset; /* File position to transfer at. */
+  unsigned data;   /* Copied to the completion. */
+};
+
+/* The outcome of a request. */
+struct aio_cqe
+{
+  unsigned data; /* From the request. */
+  int result;    /* Bytes transferred, or -1 on error. */
+};
+
+struct aio_ring
+{
+  unsigned sq_head; /* Advanced by the kernel. */
+  unsigned sq_tail; /* Advanced by the process. */
+  unsigned cq_head; /* Advanced by the process. */
+  unsigned cq_tail; /* Advanced by the kernel. */
+  struct aio_sqe sq[AIO_RING_SIZE];
+  struct aio_cqe cq[AIO_RING_SIZE];
+};
+
+#endif /* lib/aio.h */
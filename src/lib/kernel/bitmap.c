@@ -358,6 +358,48 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Returns the offset in B's file of the element holding bit
+   START, and stores the number of bytes that hold bits START
+   through START + CNT - 1 into *SIZE.  START must be the first
+   bit of an element, and START + CNT either the first bit of an
+   element or the end of B. */
+static off_t
+file_range (const struct bitmap *b, size_t start, size_t cnt, off_t *size)
+{
+  ASSERT (start % ELEM_BITS == 0);
+  ASSERT (start + cnt <= b->bit_cnt);
+  ASSERT ((start + cnt) % ELEM_BITS == 0 || start + cnt == b->bit_cnt);
+  *size = byte_cnt (start + cnt) - byte_cnt (start);
+  return byte_cnt (start);
+}
+
+/* Reads the CNT bits starting at START of B from FILE, which
+   must hold B as written by bitmap_write().  Returns true if
+   successful, false otherwise. */
+bool
+bitmap_read_range (struct bitmap *b, struct file *file, size_t start,
+                   size_t cnt)
+{
+  off_t size;
+  off_t ofs = file_range (b, start, cnt, &size);
+  bool success = file_read_at (file, (char *)b->bits + ofs, size, ofs) == size;
+  if (start + cnt == b->bit_cnt && cnt > 0)
+    b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+  return success;
+}
+
+/* Writes the CNT bits starting at START of B to FILE, which must
+   hold B as written by bitmap_write().  Returns true if
+   successful, false otherwise. */
+bool
+bitmap_write_range (const struct bitmap *b, struct file *file, size_t start,
+                    size_t cnt)
+{
+  off_t size;
+  off_t ofs = file_range (b, start, cnt, &size);
+  return file_write_at (file, (const char *)b->bits + ofs, size, ofs) == size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
@@ -59,6 +59,10 @@ static int console_lock_depth;
 /* Number of characters written to console. */
 static int64_t write_cnt;
 
+/* False to send output to the serial port only, for headless
+   runs where nobody looks at the VGA display. */
+static bool use_vga = true;
+
 /* Enable console locking. */
 void
 console_init (void)
@@ -76,6 +80,13 @@ console_panic (void)
   use_console_lock = false;
 }
 
+/* Stops rendering console output on the VGA display. */
+void
+console_disable_vga (void)
+{
+  use_vga = false;
+}
+
 /* Prints console statistics. */
 void
 console_print_stats (void)
@@ -147,13 +158,17 @@ puts (const char *s)
   return 0;
 }
 
-/* Writes the N characters in BUFFER to the console. */
+/* Writes the N characters in BUFFER to the console, handing
+   them to the serial port as one run. */
 void
 putbuf (const char *buffer, size_t n)
 {
   acquire_console ();
-  while (n-- > 0)
-    putchar_have_lock (*buffer++);
+  write_cnt += n;
+  serial_putbuf ((const uint8_t *)buffer, n);
+  if (use_vga)
+    while (n-- > 0)
+      vga_putc (*buffer++);
   release_console ();
 }
 
@@ -186,5 +201,6 @@ putchar_have_lock (uint8_t c)
   ASSERT (console_locked_by_current_thread ());
   write_cnt++;
   serial_putc (c);
-  vga_putc (c);
+  if (use_vga)
+    vga_putc (c);
 }
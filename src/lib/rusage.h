@@ -0,0 +1,26 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Room for counts of every system call number, see
+   <syscall-nr.h>. */
+#define RUSAGE_SYSCALLS 32
+
+/* Resources used by a process, as returned by the getrusage()
+   system call. */
+struct rusage
+{
+  unsigned ticks;          /* Timer ticks spent running. */
+  unsigned faults_zero;    /* Page faults that zeroed a page. */
+  unsigned faults_file;    /* Page faults that read a file. */
+  unsigned faults_swap;    /* Page faults that read from swap. */
+  unsigned faults_cow;     /* Writes that copied a shared page. */
+  uint64_t bytes_read;     /* Bytes read from files. */
+  uint64_t bytes_written;  /* Bytes written to files. */
+  unsigned swap_ins;       /* Pages read back from swap. */
+  unsigned swap_outs;      /* Pages evicted to swap to make room. */
+  unsigned syscalls[RUSAGE_SYSCALLS]; /* System calls, by number. */
+};
+
+#endif /* lib/rusage.h */
@@ -28,7 +28,20 @@ enum
   SYS_MKDIR,   /* Create a directory. */
   SYS_READDIR, /* Reads a directory entry. */
   SYS_ISDIR,   /* Tests if a fd represents a directory. */
-  SYS_INUMBER  /* Returns the inode number for a fd. */
+  SYS_INUMBER, /* Returns the inode number for a fd. */
+
+  /* Extensions. */
+  SYS_CREATE_BATCH, /* Creates many files in a directory. */
+  SYS_PREAD,        /* Read from a file at a given position. */
+  SYS_PWRITE,       /* Write to a file at a given position. */
+  SYS_READV,        /* Read from a file into several buffers. */
+  SYS_WRITEV,       /* Write to a file from several buffers. */
+  SYS_SENDFILE,     /* Copy between files inside the kernel. */
+  SYS_AIO_SETUP,    /* Register an asynchronous I/O ring. */
+  SYS_AIO_ENTER,    /* Submit and wait for asynchronous I/O. */
+  SYS_FORK,         /* Duplicate the calling process. */
+  SYS_WAIT_ANY,     /* Wait for whichever child exits first. */
+  SYS_GETRUSAGE     /* Report the resources a process has used. */
 };
 
 #endif /* lib/syscall-nr.h */
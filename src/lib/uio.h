@@ -0,0 +1,17 @@
+#ifndef __LIB_UIO_H
+#define __LIB_UIO_H
+
+#include <stddef.h>
+
+/* One buffer of a vectored read or write, as passed to the
+   readv() and writev() system calls. */
+struct iovec
+{
+  void *iov_base; /* Start of buffer. */
+  size_t iov_len; /* Length of buffer in bytes. */
+};
+
+/* Most buffers one readv() or writev() call accepts. */
+#define IOV_MAX 1024
+
+#endif /* lib/uio.h */
@@ -52,6 +52,21 @@
     retval;                                                                   \
   })
 
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                              \
+  ({                                                                          \
+    int retval;                                                               \
+    asm volatile("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "              \
+                 "pushl %[arg0]; pushl %[number]; int $0x30; "                \
+                 "addl $20, %%esp"                                            \
+                 : "=a"(retval)                                               \
+                 : [number] "i"(NUMBER), [arg0] "r"(ARG0), [arg1] "r"(ARG1),  \
+                   [arg2] "r"(ARG2), [arg3] "r"(ARG3)                         \
+                 : "memory");                                                 \
+    retval;                                                                   \
+  })
+
 void
 halt (void)
 {
@@ -173,3 +188,69 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+create_batch (int dirfd, const char *const names[], unsigned cnt)
+{
+  return syscall3 (SYS_CREATE_BATCH, dirfd, names, cnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned position)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, position);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned position)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, position);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+sendfile (int out_fd, int in_fd, unsigned size)
+{
+  return syscall3 (SYS_SENDFILE, out_fd, in_fd, size);
+}
+
+bool
+aio_setup (struct aio_ring *ring)
+{
+  return syscall1 (SYS_AIO_SETUP, ring);
+}
+
+int
+aio_enter (unsigned to_submit, unsigned min_complete)
+{
+  return syscall2 (SYS_AIO_ENTER, to_submit, min_complete);
+}
+
+pid_t
+fork (void)
+{
+  return (pid_t)syscall0 (SYS_FORK);
+}
+
+pid_t
+wait_any (int *status, int flags)
+{
+  return (pid_t)syscall2 (SYS_WAIT_ANY, status, flags);
+}
+
+bool
+getrusage (struct rusage *usage)
+{
+  return syscall1 (SYS_GETRUSAGE, usage);
+}
@@ -3,6 +3,10 @@
 
 #include <debug.h>
 #include <stdbool.h>
+#include <aio.h>
+#include <rusage.h>
+#include <uio.h>
+#include <wait.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +49,17 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int create_batch (int dirfd, const char *const names[], unsigned cnt);
+int pread (int fd, void *buffer, unsigned length, unsigned position);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned position);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int sendfile (int out_fd, int in_fd, unsigned length);
+bool aio_setup (struct aio_ring *);
+int aio_enter (unsigned to_submit, unsigned min_complete);
+pid_t fork (void);
+pid_t wait_any (int *status, int flags);
+bool getrusage (struct rusage *);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,7 @@
+#ifndef __LIB_WAIT_H
+#define __LIB_WAIT_H
+
+/* Flags for the wait_any() system call. */
+#define WNOHANG 1 /* Return 0 at once if no child has exited yet. */
+
+#endif /* lib/wait.h */
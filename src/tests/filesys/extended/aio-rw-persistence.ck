@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_archive ({"data" => [join ('', map { chr (ord ('a') + $_) x 1000 } 0 .. 7)]});
+pass;
@@ -0,0 +1,101 @@
+/* Writes the blocks of a file, then reads them back, through the
+   asynchronous I/O ring with all requests of each phase in
+   flight at once.  One more read, on a bad fd, must complete with
+   an error, and an empty read at a kernel address with 0.  The
+   bytes transferred are charged to this process, although kernel
+   worker threads move them. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <string.h>
+#include <syscall.h>
+
+#define BLOCK_SIZE 1000
+#define BLOCK_CNT 8
+
+static struct aio_ring ring;
+static char out[BLOCK_CNT][BLOCK_SIZE];
+static char in[BLOCK_CNT][BLOCK_SIZE];
+
+/* Queues a request for block BLOCK of FD. */
+static void
+submit (int op, int fd, char *buf, unsigned block)
+{
+  struct aio_sqe *sqe = &ring.sq[ring.sq_tail % AIO_RING_SIZE];
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->size = BLOCK_SIZE;
+  sqe->offset = block * BLOCK_SIZE;
+  sqe->data = block;
+  ring.sq_tail++;
+}
+
+/* Consumes CNT completions, checking that each block completed
+   once with a full transfer, except for the block numbered
+   BLOCK_CNT, which must fail. */
+static void
+reap (int cnt)
+{
+  bool seen[BLOCK_CNT + 1];
+
+  memset (seen, 0, sizeof seen);
+  while (cnt-- > 0)
+    {
+      struct aio_cqe *cqe = &ring.cq[ring.cq_head % AIO_RING_SIZE];
+      if (cqe->data > BLOCK_CNT || seen[cqe->data])
+        fail ("unexpected completion for block %u", cqe->data);
+      seen[cqe->data] = true;
+      if (cqe->data == BLOCK_CNT ? cqe->result != -1
+                                 : cqe->result != BLOCK_SIZE)
+        fail ("block %u completed with %d", cqe->data, cqe->result);
+      ring.cq_head++;
+    }
+}
+
+void
+test_main (void)
+{
+  struct rusage before, after;
+  struct aio_cqe *cqe;
+  unsigned i;
+  int fd;
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    memset (out[i], 'a' + i, BLOCK_SIZE);
+
+  CHECK (create ("data", BLOCK_CNT * BLOCK_SIZE), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (aio_setup (&ring), "aio_setup");
+  getrusage (&before);
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    submit (AIO_WRITE, fd, out[i], i);
+  CHECK (aio_enter (BLOCK_CNT, BLOCK_CNT) == BLOCK_CNT,
+         "write %d blocks", BLOCK_CNT);
+  reap (BLOCK_CNT);
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    submit (AIO_READ, fd, in[i], i);
+  submit (AIO_READ, fd + 1, in[0], BLOCK_CNT);
+  CHECK (aio_enter (BLOCK_CNT + 1, BLOCK_CNT + 1) == BLOCK_CNT + 1,
+         "read %d blocks and one bad fd", BLOCK_CNT);
+  reap (BLOCK_CNT + 1);
+  if (memcmp (in, out, sizeof out))
+    fail ("read back wrong data");
+  getrusage (&after);
+  CHECK (after.bytes_written >= before.bytes_written + sizeof out,
+         "bytes written counted");
+  CHECK (after.bytes_read >= before.bytes_read + sizeof in,
+         "bytes read counted");
+
+  submit (AIO_READ, fd, (char *)0xc0000001, 0);
+  ring.sq[(ring.sq_tail - 1) % AIO_RING_SIZE].size = 0;
+  CHECK (aio_enter (1, 1) == 1, "read 0 bytes at a kernel address");
+  cqe = &ring.cq[ring.cq_head++ % AIO_RING_SIZE];
+  if (cqe->result != 0)
+    fail ("empty read completed with %d", cqe->result);
+
+  msg ("close \"data\"");
+  close (fd);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(aio-rw) begin
+(aio-rw) create "data"
+(aio-rw) open "data"
+(aio-rw) aio_setup
+(aio-rw) write 8 blocks
+(aio-rw) read 8 blocks and one bad fd
+(aio-rw) bytes written counted
+(aio-rw) bytes read counted
+(aio-rw) read 0 bytes at a kernel address
+(aio-rw) close "data"
+(aio-rw) end
+EOF
+pass;
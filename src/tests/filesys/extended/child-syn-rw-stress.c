@@ -0,0 +1,57 @@
+/* Child process for syn-rw-stress.
+   Reads the file our parent process is growing, in reads of
+   mixed sizes, until we have read all of it.  Each read must
+   return only bytes the parent has written: a read that sees the
+   new length before its data is in place returns zeros or stale
+   bytes, which fail the comparison. */
+
+#include "tests/filesys/extended/syn-rw-stress.h"
+#include "tests/lib.h"
+#include <random.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+static char buf1[BUF_SIZE];
+static char buf2[BUF_SIZE];
+
+int
+main (int argc, const char *argv[])
+{
+  int child_idx;
+  int fd;
+  size_t ofs;
+  size_t i;
+
+  test_name = "child-syn-rw-stress";
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  random_init (0);
+  random_bytes (buf1, sizeof buf1);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  ofs = 0;
+  i = child_idx;
+  while (ofs < sizeof buf2)
+    {
+      size_t size = io_sizes[i++ % IO_SIZE_CNT];
+      int bytes_read;
+
+      if (size > sizeof buf2 - ofs)
+        size = sizeof buf2 - ofs;
+      bytes_read = read (fd, buf2 + ofs, size);
+      CHECK (bytes_read >= 0 && bytes_read <= (int)size,
+             "%zu-byte read on \"%s\" returned invalid value of %d", size,
+             file_name, bytes_read);
+      if (bytes_read > 0)
+        {
+          compare_bytes (buf2 + ofs, buf1 + ofs, bytes_read, ofs, file_name);
+          ofs += bytes_read;
+        }
+    }
+  close (fd);
+
+  return child_idx;
+}
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($fs);
+$fs->{'d'}{"f$_"} = [''] foreach 0...99;
+$fs->{'d'}{$_} = [''] foreach qw (a b x ok);
+check_archive ($fs);
+pass;
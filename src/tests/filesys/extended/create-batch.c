@@ -0,0 +1,71 @@
+/* Creates files in bulk with create_batch(): a batch big enough
+   to grow the directory, then batches that stop at a name
+   repeated within the batch, a name already in the directory and
+   a name that is too long. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <stdio.h>
+#include <syscall.h>
+
+#define BIG_CNT 100
+
+static char big_names[BIG_CNT][8];
+
+/* Fails unless file NAME in directory "d" exists exactly when
+   EXISTS is true. */
+static void
+expect_file (const char *name, bool exists)
+{
+  char path[32];
+  int fd;
+
+  snprintf (path, sizeof path, "d/%s", name);
+  fd = open (path);
+  if ((fd > 1) != exists)
+    fail ("\"%s\" %s", path, exists ? "missing" : "created");
+  if (fd > 1)
+    close (fd);
+}
+
+void
+test_main (void)
+{
+  const char *big[BIG_CNT];
+  const char *dup[] = { "a", "b", "a", "c" };
+  const char *existing[] = { "x", "f5", "y" };
+  const char *overlong[] = { "ok", "fifteen-chars-x", "z" };
+  int dirfd, i;
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  CHECK ((dirfd = open ("d")) > 1, "open \"d\"");
+
+  for (i = 0; i < BIG_CNT; i++)
+    {
+      snprintf (big_names[i], sizeof big_names[i], "f%d", i);
+      big[i] = big_names[i];
+    }
+  CHECK (create_batch (dirfd, big, BIG_CNT) == BIG_CNT,
+         "create_batch %d files", BIG_CNT);
+  for (i = 0; i < BIG_CNT; i++)
+    expect_file (big[i], true);
+
+  CHECK (create_batch (dirfd, dup, 4) == 2,
+         "create_batch stops at a repeated name");
+  expect_file ("a", true);
+  expect_file ("b", true);
+  expect_file ("c", false);
+
+  CHECK (create_batch (dirfd, existing, 3) == 1,
+         "create_batch stops at an existing name");
+  expect_file ("x", true);
+  expect_file ("y", false);
+
+  CHECK (create_batch (dirfd, overlong, 3) == 1,
+         "create_batch stops at an overlong name");
+  expect_file ("ok", true);
+  expect_file ("z", false);
+
+  msg ("close \"d\"");
+  close (dirfd);
+}
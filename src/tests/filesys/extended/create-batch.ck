@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(create-batch) begin
+(create-batch) mkdir "d"
+(create-batch) open "d"
+(create-batch) create_batch 100 files
+(create-batch) create_batch stops at a repeated name
+(create-batch) create_batch stops at an existing name
+(create-batch) create_batch stops at an overlong name
+(create-batch) close "d"
+(create-batch) end
+EOF
+pass;
@@ -0,0 +1,37 @@
+/* Creates a file larger than the disk, which must fail and free
+   whatever it allocated, then a file larger than one journal
+   operation can allocate, which must read back as zeros. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <syscall.h>
+
+#define BIG_SIZE 700000
+
+static char buf[4096];
+
+void
+test_main (void)
+{
+  size_t ofs, i;
+  int fd, n;
+
+  CHECK (!create ("huge", 8000000), "create \"huge\" fails");
+  CHECK (create ("big", BIG_SIZE), "create \"big\"");
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+  CHECK (filesize (fd) == BIG_SIZE, "filesize \"big\"");
+
+  msg ("read \"big\"");
+  for (ofs = 0; ofs < BIG_SIZE; ofs += n)
+    {
+      n = read (fd, buf, sizeof buf);
+      if (n <= 0)
+        fail ("read returned %d at offset %zu", n, ofs);
+      for (i = 0; i < (size_t)n; i++)
+        if (buf[i] != 0)
+          fail ("byte %zu is %d, not 0", ofs + i, buf[i]);
+    }
+
+  msg ("close \"big\"");
+  close (fd);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(create-large) begin
+(create-large) create "huge" fails
+(create-large) create "big"
+(create-large) open "big"
+(create-large) filesize "big"
+(create-large) read "big"
+(create-large) close "big"
+(create-large) end
+EOF
+pass;
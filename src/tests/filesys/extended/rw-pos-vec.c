@@ -0,0 +1,86 @@
+/* Writes a file out of order with pwrite() and appends to it
+   with writev(), then reads it back with pread() and readv(),
+   checking that positional I/O leaves the file position alone
+   and that readv() refuses lengths adding up past INT_MAX.  Then
+   fills the disk and checks that writes which cannot grow the
+   file fail without changing it or its position. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Creates files "fill0", "fill1", ... until not even a one-byte
+   file fits on the disk.  Returns the number of files. */
+static int
+fill_disk (void)
+{
+  char name[16];
+  unsigned size = 1024 * 1024;
+  int cnt = 0;
+
+  while (size > 0)
+    {
+      snprintf (name, sizeof name, "fill%d", cnt);
+      if (create (name, size))
+        cnt++;
+      else
+        size /= 2;
+    }
+  return cnt;
+}
+
+void
+test_main (void)
+{
+  static char bang[] = "!", bye[] = " bye";
+  char buf[32], head[5], tail[11];
+  struct iovec out[2] = { { bang, 1 }, { bye, 4 } };
+  struct iovec in[2] = { { head, sizeof head }, { tail, sizeof tail } };
+  struct iovec huge[2] = { { head, INT_MAX }, { tail, 2 } };
+  char name[16];
+  int fd, cnt, i;
+
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+
+  CHECK (pwrite (fd, "world", 5, 6) == 5, "pwrite \"world\" at 6");
+  CHECK (pwrite (fd, "hello ", 6, 0) == 6, "pwrite \"hello \" at 0");
+  if (tell (fd) != 0)
+    fail ("pwrite moved the file position to %u", tell (fd));
+  CHECK (pread (fd, buf, 11, 0) == 11, "pread 11 bytes at 0");
+  if (memcmp (buf, "hello world", 11))
+    fail ("pread returned wrong data");
+
+  seek (fd, 11);
+  CHECK (writev (fd, out, 2) == 5, "writev 2 buffers");
+  seek (fd, 0);
+  CHECK (readv (fd, in, 2) == 16, "readv 2 buffers");
+  if (memcmp (head, "hello", 5) || memcmp (tail, " world! bye", 11))
+    fail ("readv returned wrong data");
+  CHECK (readv (fd, huge, 2) == -1, "readv more than INT_MAX bytes");
+
+  msg ("fill the disk");
+  cnt = fill_disk ();
+  CHECK (pwrite (fd, buf, sizeof buf, 4096) == -1,
+         "pwrite past the end of a full disk fails");
+  CHECK (pwrite (fd, "hello", 5, 0) == 5, "pwrite \"hello\" at 0");
+  seek (fd, 4096);
+  CHECK (write (fd, buf, sizeof buf) == -1,
+         "write past the end of a full disk fails");
+  if (tell (fd) != 4096)
+    fail ("failed write moved the file position to %u", tell (fd));
+  CHECK (filesize (fd) == 16, "filesize is still 16");
+  msg ("remove the fill files");
+  for (i = 0; i < cnt; i++)
+    {
+      snprintf (name, sizeof name, "fill%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+
+  msg ("close \"data\"");
+  close (fd);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rw-pos-vec) begin
+(rw-pos-vec) create "data"
+(rw-pos-vec) open "data"
+(rw-pos-vec) pwrite "world" at 6
+(rw-pos-vec) pwrite "hello " at 0
+(rw-pos-vec) pread 11 bytes at 0
+(rw-pos-vec) writev 2 buffers
+(rw-pos-vec) readv 2 buffers
+(rw-pos-vec) readv more than INT_MAX bytes
+(rw-pos-vec) fill the disk
+(rw-pos-vec) pwrite past the end of a full disk fails
+(rw-pos-vec) pwrite "hello" at 0
+(rw-pos-vec) write past the end of a full disk fails
+(rw-pos-vec) filesize is still 16
+(rw-pos-vec) remove the fill files
+(rw-pos-vec) close "data"
+(rw-pos-vec) end
+EOF
+pass;
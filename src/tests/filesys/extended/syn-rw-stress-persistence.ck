@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_archive ({"child-syn-rw-stress" => "tests/filesys/extended/child-syn-rw-stress",
+		"logfile" => [random_bytes (32 * 512)]});
+pass;
@@ -0,0 +1,41 @@
+/* Grows a file by writes of mixed sizes, crossing sector
+   boundaries, while many subprocesses read the growing file. */
+
+#include "tests/filesys/extended/syn-rw-stress.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <random.h>
+#include <syscall.h>
+
+char buf[BUF_SIZE];
+
+#define CHILD_CNT 8
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  size_t ofs, size;
+  size_t i;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  exec_children ("child-syn-rw-stress", children, CHILD_CNT);
+
+  random_bytes (buf, sizeof buf);
+  quiet = true;
+  for (ofs = 0, i = 0; ofs < BUF_SIZE; ofs += size, i++)
+    {
+      size = io_sizes[i % IO_SIZE_CNT];
+      if (size > BUF_SIZE - ofs)
+        size = BUF_SIZE - ofs;
+      CHECK (write (fd, buf + ofs, size) == (int)size,
+             "write %zu bytes at offset %zu in \"%s\"", size, ofs,
+             file_name);
+    }
+  quiet = false;
+
+  wait_children (children, CHILD_CNT);
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-rw-stress) begin
+(syn-rw-stress) create "logfile"
+(syn-rw-stress) open "logfile"
+(syn-rw-stress) exec child 1 of 8: "child-syn-rw-stress 0"
+(syn-rw-stress) exec child 2 of 8: "child-syn-rw-stress 1"
+(syn-rw-stress) exec child 3 of 8: "child-syn-rw-stress 2"
+(syn-rw-stress) exec child 4 of 8: "child-syn-rw-stress 3"
+(syn-rw-stress) exec child 5 of 8: "child-syn-rw-stress 4"
+(syn-rw-stress) exec child 6 of 8: "child-syn-rw-stress 5"
+(syn-rw-stress) exec child 7 of 8: "child-syn-rw-stress 6"
+(syn-rw-stress) exec child 8 of 8: "child-syn-rw-stress 7"
+(syn-rw-stress) wait for child 1 of 8 returned 0 (expected 0)
+(syn-rw-stress) wait for child 2 of 8 returned 1 (expected 1)
+(syn-rw-stress) wait for child 3 of 8 returned 2 (expected 2)
+(syn-rw-stress) wait for child 4 of 8 returned 3 (expected 3)
+(syn-rw-stress) wait for child 5 of 8 returned 4 (expected 4)
+(syn-rw-stress) wait for child 6 of 8 returned 5 (expected 5)
+(syn-rw-stress) wait for child 7 of 8 returned 6 (expected 6)
+(syn-rw-stress) wait for child 8 of 8 returned 7 (expected 7)
+(syn-rw-stress) end
+EOF
+pass;
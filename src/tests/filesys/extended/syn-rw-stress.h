@@ -0,0 +1,12 @@
+#ifndef TESTS_FILESYS_EXTENDED_SYN_RW_STRESS_H
+#define TESTS_FILESYS_EXTENDED_SYN_RW_STRESS_H
+
+#define BUF_SIZE (32 * 512)
+static const char file_name[] = "logfile";
+
+/* Sizes of the writes and reads, chosen to start and end at
+   every kind of offset within a sector. */
+static const int io_sizes[] = { 1, 511, 513, 100, 1024, 37, 2000, 7 };
+#define IO_SIZE_CNT (sizeof io_sizes / sizeof *io_sizes)
+
+#endif /* tests/filesys/extended/syn-rw-stress.h */
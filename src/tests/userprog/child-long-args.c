@@ -0,0 +1,22 @@
+/* Child process run by exec-long.  Checks that every argument of
+   its long command line arrived intact. */
+
+#include "tests/lib.h"
+#include <string.h>
+
+#define ARGS 2000
+#define LONG_ARG 6000
+
+int
+main (int argc, char *argv[])
+{
+  test_name = "child-long-args";
+
+  CHECK (argc == ARGS + 2, "argc == %d", ARGS + 2);
+  for (int i = 0; i < ARGS; i++)
+    if (argv[i + 1][0] != 'a' + i % 26 || argv[i + 1][1] != '\0')
+      fail ("argv[%d] is \"%s\"", i + 1, argv[i + 1]);
+  CHECK (strlen (argv[ARGS + 1]) == LONG_ARG, "long argument intact");
+  CHECK (argv[argc] == NULL, "argv[argc] is null");
+  return 42;
+}
@@ -0,0 +1,16 @@
+/* Child process run by exec-cached.
+   Exits with the number of bytes it has read from files, which
+   includes its own executable's headers unless exec found them in
+   the cache. */
+
+#include <syscall.h>
+
+int
+main (void)
+{
+  struct rusage usage;
+
+  if (!getrusage (&usage))
+    return -1;
+  return usage.bytes_read;
+}
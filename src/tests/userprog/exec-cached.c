@@ -0,0 +1,36 @@
+/* Executes the same program twice in a row and checks that the
+   second exec finds the program's headers in the exec cache
+   rather than reading them again, although nothing kept the
+   program open in between. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <syscall.h>
+
+/* Returns the size of the ELF header and program headers of
+   FILE. */
+static int
+header_bytes (const char *file)
+{
+  unsigned char ehdr[52];
+  int fd;
+
+  CHECK ((fd = open (file)) > 1, "open \"%s\"", file);
+  CHECK (read (fd, ehdr, sizeof ehdr) == sizeof ehdr,
+         "read ELF header of \"%s\"", file);
+  close (fd);
+  // e_phnum program headers of 32 bytes each
+  return sizeof ehdr + 32 * (ehdr[44] | ehdr[45] << 8);
+}
+
+void
+test_main (void)
+{
+  int headers = header_bytes ("child-rusage");
+  int first = wait (exec ("child-rusage"));
+  int second = wait (exec ("child-rusage"));
+
+  if (first - second < headers)
+    fail ("second exec read %d bytes, first read %d", second, first);
+  msg ("second exec read no headers");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(exec-cached) begin
+(exec-cached) open "child-rusage"
+(exec-cached) read ELF header of "child-rusage"
+(exec-cached) second exec read no headers
+(exec-cached) end
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Executes a child with a command line several pages long and
+   more arguments than fit in a page of argv pointers. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <string.h>
+#include <syscall.h>
+
+#define ARGS 2000
+#define LONG_ARG 6000
+
+static char cmd_line[sizeof "child-long-args" + ARGS * 2 + LONG_ARG + 2];
+
+void
+test_main (void)
+{
+  char *p = cmd_line;
+
+  strlcpy (p, "child-long-args", sizeof cmd_line);
+  p += strlen (p);
+  for (int i = 0; i < ARGS; i++)
+    {
+      *p++ = ' ';
+      *p++ = 'a' + i % 26;
+    }
+  *p++ = ' ';
+  memset (p, 'z', LONG_ARG);
+  p[LONG_ARG] = '\0';
+
+  msg ("wait(exec()) = %d", wait (exec (cmd_line)));
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(exec-long) begin
+(child-long-args) argc == 2002
+(child-long-args) long argument intact
+(child-long-args) argv[argc] is null
+child-long-args: exit(42)
+(exec-long) wait(exec()) = 42
+(exec-long) end
+exec-long: exit(0)
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Executes a program, overwrites its file in place with a
+   different program and executes it again, checking that the
+   second exec runs the new program rather than a cached image of
+   the old one.  "prog" stays open throughout, so only the write,
+   not closing and opening the file again, can tell the exec cache
+   that it changed. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <syscall.h>
+
+static char buf[512];
+
+/* Copies the contents of file FROM over the start of file TO. */
+static void
+copy_over (const char *from, const char *to)
+{
+  int in, out, n;
+
+  CHECK ((in = open (from)) > 1, "open \"%s\"", from);
+  CHECK ((out = open (to)) > 1, "open \"%s\"", to);
+  while ((n = read (in, buf, sizeof buf)) > 0)
+    if (write (out, buf, n) != n)
+      fail ("write to \"%s\" failed", to);
+  close (in);
+  close (out);
+}
+
+void
+test_main (void)
+{
+  int fd;
+
+  CHECK (create ("prog", 0), "create \"prog\"");
+  CHECK ((fd = open ("prog")) > 1, "open \"prog\"");
+  copy_over ("child-simple", "prog");
+  msg ("wait(exec()) = %d", wait (exec ("prog")));
+
+  copy_over ("child-args", "prog");
+  msg ("wait(exec()) = %d", wait (exec ("prog arg")));
+  close (fd);
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(exec-rewrite) begin
+(exec-rewrite) create "prog"
+(exec-rewrite) open "prog"
+(exec-rewrite) open "child-simple"
+(exec-rewrite) open "prog"
+(child-simple) run
+prog: exit(81)
+(exec-rewrite) wait(exec()) = 81
+(exec-rewrite) open "child-args"
+(exec-rewrite) open "prog"
+(args) begin
+(args) argc = 2
+(args) argv[0] = 'prog'
+(args) argv[1] = 'arg'
+(args) argv[2] = null
+(args) end
+prog: exit(0)
+(exec-rewrite) wait(exec()) = 0
+(exec-rewrite) end
+exec-rewrite: exit(0)
+EOF
+pass;
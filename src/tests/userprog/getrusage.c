@@ -0,0 +1,38 @@
+/* Checks that getrusage() counts the calling process's system
+   calls, file bytes and timer ticks. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <syscall-nr.h>
+#include <syscall.h>
+
+static char buf[100];
+
+void
+test_main (void)
+{
+  struct rusage before, after;
+  int fd;
+
+  CHECK (getrusage (&before), "getrusage");
+  CHECK (create ("usage.dat", 0), "create \"usage.dat\"");
+  CHECK ((fd = open ("usage.dat")) > 1, "open \"usage.dat\"");
+  write (fd, buf, sizeof buf);
+  seek (fd, 0);
+  read (fd, buf, sizeof buf);
+  close (fd);
+  getrusage (&after);
+
+  CHECK (after.syscalls[SYS_CREATE] == before.syscalls[SYS_CREATE] + 1,
+         "create counted");
+  CHECK (after.syscalls[SYS_GETRUSAGE] == before.syscalls[SYS_GETRUSAGE] + 1,
+         "getrusage counted");
+  CHECK (after.bytes_written >= before.bytes_written + sizeof buf,
+         "bytes written counted");
+  CHECK (after.bytes_read >= before.bytes_read + sizeof buf,
+         "bytes read counted");
+
+  while (after.ticks == before.ticks)
+    getrusage (&after);
+  msg ("ticks counted");
+}
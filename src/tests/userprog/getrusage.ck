@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getrusage) begin
+(getrusage) getrusage
+(getrusage) create "usage.dat"
+(getrusage) open "usage.dat"
+(getrusage) create counted
+(getrusage) getrusage counted
+(getrusage) bytes written counted
+(getrusage) bytes read counted
+(getrusage) ticks counted
+(getrusage) end
+getrusage: exit(0)
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Opens the same file hundreds of times, which must return a
+   different file descriptor each time, then closes every other
+   one and checks that new opens reuse the lowest free
+   descriptors first. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/sample.inc"
+#include <syscall.h>
+
+#define OPEN_CNT 300
+
+static int handles[OPEN_CNT];
+
+void
+test_main (void)
+{
+  int i, j;
+
+  for (i = 0; i < OPEN_CNT; i++)
+    {
+      handles[i] = open ("sample.txt");
+      if (handles[i] < 2)
+        fail ("open #%d returned %d", i, handles[i]);
+      for (j = 0; j < i; j++)
+        if (handles[j] == handles[i])
+          fail ("open #%d and #%d both returned %d", j, i, handles[i]);
+    }
+  msg ("opened \"sample.txt\" %d times", OPEN_CNT);
+
+  check_file_handle (handles[OPEN_CNT - 1], "sample.txt", sample,
+                     sizeof sample - 1);
+
+  for (i = 0; i < OPEN_CNT; i += 2)
+    close (handles[i]);
+  msg ("closed every other handle");
+
+  for (i = 0; i < OPEN_CNT; i += 2)
+    {
+      int handle = open ("sample.txt");
+      if (handle != handles[i])
+        fail ("reopen returned %d, expected lowest free %d", handle,
+              handles[i]);
+    }
+  msg ("reopened into the lowest free handles");
+
+  for (i = 0; i < OPEN_CNT; i++)
+    close (handles[i]);
+  msg ("closed all handles");
+}
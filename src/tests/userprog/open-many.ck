@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-many) begin
+(open-many) opened "sample.txt" 300 times
+(open-many) verified contents of "sample.txt"
+(open-many) closed every other handle
+(open-many) reopened into the lowest free handles
+(open-many) closed all handles
+(open-many) end
+open-many: exit(0)
+EOF
+pass;
@@ -0,0 +1,91 @@
+/* Copies between files and to the console with sendfile(),
+   including a copy that stops at end of file and copies onto a
+   full disk, which must stop at the first chunk that cannot be
+   written and leave the source positioned just after the bytes
+   that were copied. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+/* sendfile() copies a page at a time. */
+#define PAGE 4096
+
+static char buf[2 * PAGE];
+
+/* Creates files "fill0", "fill1", ... until not even a one-byte
+   file fits on the disk. */
+static void
+fill_disk (void)
+{
+  char name[16];
+  unsigned size = 1024 * 1024;
+  int cnt = 0;
+
+  while (size > 0)
+    {
+      snprintf (name, sizeof name, "fill%d", cnt);
+      if (create (name, size))
+        cnt++;
+      else
+        size /= 2;
+    }
+}
+
+void
+test_main (void)
+{
+  static const char text[] = "sendfile to the console\n";
+  int src, copy, txt, dst;
+  size_t i;
+
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = 'a' + i % 26;
+  CHECK (create ("src", 0), "create \"src\"");
+  CHECK ((src = open ("src")) > 1, "open \"src\"");
+  CHECK (write (src, buf, sizeof buf) == (int)sizeof buf, "write \"src\"");
+
+  CHECK (create ("copy", 0), "create \"copy\"");
+  CHECK ((copy = open ("copy")) > 1, "open \"copy\"");
+  seek (src, 0);
+  CHECK (sendfile (copy, src, sizeof buf) == (int)sizeof buf,
+         "sendfile \"src\" to \"copy\"");
+  close (copy);
+  check_file ("copy", buf, sizeof buf);
+
+  seek (src, sizeof buf - 100);
+  CHECK (sendfile (1, src, 0) == 0, "sendfile 0 bytes");
+  CHECK (create ("copy2", 0), "create \"copy2\"");
+  CHECK ((copy = open ("copy2")) > 1, "open \"copy2\"");
+  CHECK (sendfile (copy, src, 1000) == 100,
+         "sendfile stops at end of \"src\"");
+  close (copy);
+  check_file ("copy2", buf + sizeof buf - 100, 100);
+
+  CHECK (create ("text", 0), "create \"text\"");
+  CHECK ((txt = open ("text")) > 1, "open \"text\"");
+  CHECK (write (txt, text, strlen (text)) == (int)strlen (text),
+         "write \"text\"");
+  seek (txt, 0);
+  CHECK (sendfile (1, txt, 100) == (int)strlen (text),
+         "sendfile \"text\" to the console");
+  close (txt);
+
+  /* "dst" owns one page of sectors, so copying over it succeeds
+     once the disk is full but growing it past that page fails. */
+  CHECK (create ("dst", PAGE), "create \"dst\"");
+  CHECK ((dst = open ("dst")) > 1, "open \"dst\"");
+  msg ("fill the disk");
+  fill_disk ();
+  seek (src, 0);
+  CHECK (sendfile (dst, src, sizeof buf) == PAGE,
+         "sendfile to a full disk copies one page");
+  CHECK (tell (src) == PAGE, "\"src\" is left after the copied page");
+  CHECK (sendfile (dst, src, sizeof buf) == -1,
+         "sendfile past the end of a full disk fails");
+  CHECK (tell (src) == PAGE, "\"src\" is left where it was");
+  close (dst);
+  check_file ("dst", buf, PAGE);
+}
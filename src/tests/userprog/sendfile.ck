@@ -0,0 +1,41 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sendfile) begin
+(sendfile) create "src"
+(sendfile) open "src"
+(sendfile) write "src"
+(sendfile) create "copy"
+(sendfile) open "copy"
+(sendfile) sendfile "src" to "copy"
+(sendfile) open "copy" for verification
+(sendfile) verified contents of "copy"
+(sendfile) close "copy"
+(sendfile) sendfile 0 bytes
+(sendfile) create "copy2"
+(sendfile) open "copy2"
+(sendfile) sendfile stops at end of "src"
+(sendfile) open "copy2" for verification
+(sendfile) verified contents of "copy2"
+(sendfile) close "copy2"
+(sendfile) create "text"
+(sendfile) open "text"
+(sendfile) write "text"
+sendfile to the console
+(sendfile) sendfile "text" to the console
+(sendfile) create "dst"
+(sendfile) open "dst"
+(sendfile) fill the disk
+(sendfile) sendfile to a full disk copies one page
+(sendfile) "src" is left after the copied page
+(sendfile) sendfile past the end of a full disk fails
+(sendfile) "src" is left where it was
+(sendfile) open "dst" for verification
+(sendfile) verified contents of "dst"
+(sendfile) close "dst"
+(sendfile) end
+sendfile: exit(0)
+EOF
+pass;
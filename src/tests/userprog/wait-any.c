@@ -0,0 +1,28 @@
+/* Waits for children with wait_any(), first blocking, then
+   polling with WNOHANG, and checks that a reaped child cannot be
+   waited for again. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <syscall.h>
+
+void
+test_main (void)
+{
+  pid_t pid;
+  int status = 0;
+
+  CHECK (wait_any (&status, WNOHANG) == -1, "wait_any with no children");
+
+  CHECK ((pid = exec ("child-simple")) != PID_ERROR, "exec child-simple");
+  CHECK (wait_any (&status, 0) == pid && status == 81, "wait_any");
+
+  CHECK ((pid = exec ("child-simple")) != PID_ERROR, "exec child-simple");
+  pid_t reaped;
+  while ((reaped = wait_any (&status, WNOHANG)) == 0)
+    continue;
+  CHECK (reaped == pid && status == 81, "wait_any with WNOHANG");
+
+  CHECK (wait (pid) == -1, "wait for reaped child");
+  CHECK (wait_any (&status, 0) == -1, "wait_any with no children left");
+}
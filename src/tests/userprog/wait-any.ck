@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(wait-any) begin
+(wait-any) wait_any with no children
+(wait-any) exec child-simple
+(child-simple) run
+child-simple: exit(81)
+(wait-any) wait_any
+(wait-any) exec child-simple
+(child-simple) run
+child-simple: exit(81)
+(wait-any) wait_any with WNOHANG
+(wait-any) wait for reaped child
+(wait-any) wait_any with no children left
+(wait-any) end
+wait-any: exit(0)
+EOF
+pass;
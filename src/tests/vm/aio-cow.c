@@ -0,0 +1,63 @@
+/* Forks, then has the child read a file into a static buffer
+   shared copy-on-write with the parent, through an asynchronous
+   I/O ring that neither process has touched yet.  The read must
+   go to the child's own copy: the parent still sees its values
+   afterward. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <string.h>
+#include <syscall.h>
+
+#define SIZE (2 * 4096)
+
+static struct aio_ring ring;
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  pid_t pid;
+  size_t i;
+  int fd;
+
+  memset (buf, 'd', sizeof buf);
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (write (fd, buf, SIZE) == SIZE, "write \"data\"");
+  memset (buf, 'p', sizeof buf);
+
+  msg ("fork");
+  pid = fork ();
+  if (pid == 0)
+    {
+      struct aio_sqe *sqe = &ring.sq[0];
+      struct aio_cqe *cqe = &ring.cq[0];
+
+      if (!aio_setup (&ring))
+        fail ("child: aio_setup failed");
+      sqe->op = AIO_READ;
+      sqe->fd = fd;
+      sqe->buf = buf;
+      sqe->size = SIZE;
+      sqe->offset = 0;
+      sqe->data = 7;
+      ring.sq_tail++;
+      if (aio_enter (1, 1) != 1)
+        fail ("child: aio_enter failed");
+      if (cqe->data != 7 || cqe->result != SIZE)
+        fail ("child: read completed with %d", cqe->result);
+      for (i = 0; i < SIZE; i++)
+        if (buf[i] != 'd')
+          fail ("child: byte %zu != 'd'", i);
+      msg ("child read into its copy");
+      exit (81);
+    }
+
+  CHECK (pid != PID_ERROR, "fork returned");
+  CHECK (wait (pid) == 81, "wait for child");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 'p')
+      fail ("byte %zu != 'p'", i);
+  msg ("parent's copy unchanged");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-cow) begin
+(aio-cow) create "data"
+(aio-cow) open "data"
+(aio-cow) write "data"
+(aio-cow) fork
+(aio-cow) child read into its copy
+aio-cow: exit(81)
+(aio-cow) fork returned
+(aio-cow) wait for child
+(aio-cow) parent's copy unchanged
+(aio-cow) end
+aio-cow: exit(0)
+EOF
+pass;
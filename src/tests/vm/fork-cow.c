@@ -0,0 +1,45 @@
+/* Forks, then has the child check and overwrite a static buffer
+   and a local variable.  The child's writes must go to its own
+   copies: the parent still sees its values afterward. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+#include <string.h>
+#include <syscall.h>
+
+#define SIZE (2 * 4096)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  int local = 1;
+  pid_t pid;
+  size_t i;
+
+  memset (buf, 'p', sizeof buf);
+  msg ("fork");
+  pid = fork ();
+  if (pid == 0)
+    {
+      for (i = 0; i < SIZE; i++)
+        if (buf[i] != 'p')
+          fail ("child: byte %zu != 'p'", i);
+      if (local != 1)
+        fail ("child: local == %d", local);
+      memset (buf, 'c', sizeof buf);
+      local = 2;
+      msg ("child wrote its copy");
+      exit (81);
+    }
+
+  CHECK (pid != PID_ERROR, "fork returned");
+  CHECK (wait (pid) == 81, "wait for child");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 'p')
+      fail ("byte %zu != 'p'", i);
+  if (local != 1)
+    fail ("local == %d", local);
+  msg ("parent's copy unchanged");
+}
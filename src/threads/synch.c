@@ -337,3 +337,88 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes readers-writer lock RW. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->can_read);
+  cond_init (&rw->can_write);
+  rw->readers = 0;
+  rw->waiting_writers = 0;
+  rw->writer = false;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.  A reader must not acquire RW again before
+   releasing it, since a writer arriving in between would
+   deadlock the two.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+  while (rw->writer || rw->waiting_writers > 0)
+    cond_wait (&rw->can_read, &rw->lock);
+  rw->readers++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0)
+    cond_signal (&rw->can_write, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no reader or other
+   writer holds it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+  rw->waiting_writers++;
+  while (rw->writer || rw->readers > 0)
+    cond_wait (&rw->can_write, &rw->lock);
+  rw->waiting_writers--;
+  rw->writer = true;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing, and
+   hands it to the next waiting writer, or else to all waiting
+   readers. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer);
+  rw->writer = false;
+  if (rw->waiting_writers > 0)
+    cond_signal (&rw->can_write, &rw->lock);
+  else
+    cond_broadcast (&rw->can_read, &rw->lock);
+  lock_release (&rw->lock);
+}
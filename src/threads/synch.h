@@ -41,6 +41,25 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock.  Any number of readers may hold it at
+   once, or a single writer.  Waiting writers keep new readers
+   out, so a steady stream of readers cannot starve them. */
+struct rwlock
+{
+  struct lock lock;           /* Protects the members below. */
+  struct condition can_read;  /* Signaled when readers may enter. */
+  struct condition can_write; /* Signaled when a writer may enter. */
+  unsigned readers;           /* Number of readers holding the lock. */
+  unsigned waiting_writers;   /* Number of writers waiting. */
+  bool writer;                /* True if a writer holds the lock. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
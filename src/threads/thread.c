@@ -133,6 +133,9 @@ thread_tick (void)
 #endif
   else
     kernel_ticks++;
+#ifdef USERPROG
+  t->rusage.ticks++;
+#endif
 
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
@@ -485,11 +488,19 @@ init_thread (struct thread *t, const char *name, int priority)
   t->magic = THREAD_MAGIC;
 #ifdef FILESYS
   t->working_directory = NULL;
+  t->aio = NULL;
 #endif
 
   // for process management
   t->pagedir = NULL;
   t->proc = NULL;
+  t->console_buf = NULL;
+  t->console_len = 0;
+#ifdef VM
+  t->supplemental_table = NULL;
+  list_init (&t->mmap_list);
+  t->next_mapid = 0;
+#endif
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
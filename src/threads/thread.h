@@ -2,9 +2,11 @@
 #define THREADS_THREAD_H
 
 #include "filesys/directory.h"
+#include "userprog/fd-table.h"
 #include "userprog/process.h"
 #include <debug.h>
 #include <list.h>
+#include <rusage.h>
 #include <stdint.h>
 
 /* States in a thread's life cycle. */
@@ -106,11 +108,23 @@ struct thread
      the parent proecss deallocate it for the children
   */
   struct proc_record *proc; // data records for process control
+  char *console_buf;        // console output not yet written, or NULL
+  size_t console_len;       // bytes in console_buf
+  struct rusage rusage;     // resources used, see getrusage()
 #endif
 
 #ifdef FILESYS
-  struct list fd_list;           // list used to record file descriptors.
+  struct fd_table fd_table;      // open files and directories by fd
   struct dir *working_directory; // The working directory
+  int journal_depth;             // nesting of journal_begin() calls
+  struct aio_ctx *aio;           // asynchronous I/O state, or NULL
+#endif
+
+#ifdef VM
+  struct vm_sup_page_table *supplemental_table; // pages not in pagedir
+  struct list mmap_list;                        // memory-mapped files
+  int next_mapid;                               // id of the next mapping
+  void *user_esp;                               // user esp at syscall entry
 #endif
 
   /* Owned by thread.c. */
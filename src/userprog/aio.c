@@ -0,0 +1,420 @@
+#include "userprog/aio.h"
+#include "filesys/file.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#ifdef VM
+#include "vm/sup_page.h"
+#endif
+
+/* Asynchronous I/O needs file descriptors, which exist only in
+   kernels built with the file system. */
+#ifdef FILESYS
+
+/* Number of kernel threads serving requests. */
+#define AIO_WORKERS 4
+
+/* A process's asynchronous I/O state. */
+struct aio_ctx
+{
+  struct aio_ring *ring; /* The ring, in user memory. */
+  uint32_t *pagedir;     /* Page directory the ring lives in. */
+  struct lock lock;      /* Protects the members below. */
+  struct condition done; /* Signaled when a request completes. */
+  unsigned cq_tail;      /* Kernel copy of ring->cq_tail. */
+  unsigned inflight;     /* Requests queued or being served. */
+};
+
+/* A request handed to the workers. */
+struct aio_work
+{
+  struct list_elem elem; /* Element in work_queue. */
+  struct aio_ctx *ctx;   /* Submitting process. */
+  struct rusage *rusage; /* Submitting process's, charged for I/O. */
+  struct file *file;     /* Private reopening of the request's file. */
+  struct aio_sqe sqe;    /* The request. */
+};
+
+/* Requests waiting for a worker. */
+static struct list work_queue;
+static struct lock work_lock;
+static struct condition work_ready;
+
+static void start_workers (void);
+static void aio_worker (void *);
+static bool pin_user_range (uint32_t *pd, const void *, size_t,
+                            bool writable);
+static void unpin_user_range (uint32_t *pd, const void *, size_t);
+static bool copy_out (uint32_t *pd, void *udst, const void *src,
+                      size_t size);
+static bool copy_in (uint32_t *pd, void *dst, const void *usrc,
+                     size_t size);
+static void post (struct aio_ctx *, unsigned data, int result, bool served);
+
+/* Registers RING, in the current process's memory, as its ring
+   for asynchronous I/O, and resets its indexes.  Returns false if
+   the process already has a ring, RING is not writable user
+   memory, or out of memory. */
+bool
+aio_setup (struct aio_ring *ring)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->aio != NULL
+      || !pin_user_range (cur->pagedir, ring, sizeof *ring, true))
+    return false;
+  struct aio_ctx *ctx = malloc (sizeof *ctx);
+  if (ctx == NULL)
+    {
+      unpin_user_range (cur->pagedir, ring, sizeof *ring);
+      return false;
+    }
+  start_workers ();
+
+  ctx->ring = ring;
+  ctx->pagedir = cur->pagedir;
+  lock_init (&ctx->lock);
+  cond_init (&ctx->done);
+  ctx->cq_tail = 0;
+  ctx->inflight = 0;
+  unsigned zeros[4] = { 0, 0, 0, 0 };
+  copy_out (ctx->pagedir, ring, zeros, sizeof zeros);
+  unpin_user_range (ctx->pagedir, ring, sizeof *ring);
+  cur->aio = ctx;
+  return true;
+}
+
+/* Submits up to TO_SUBMIT requests from the current process's
+   ring, then waits until at least MIN_COMPLETE completions are
+   ready to consume, or nothing is left in flight.  A request the
+   kernel rejects, for a bad fd or buffer, completes at once with
+   result -1.  Submission stops early while the completion half of
+   the ring could not hold a completion for every request.  The
+   ring, and the buffer of each request in flight, stay pinned in
+   memory meanwhile.  Returns the number of completions ready, or
+   -1 if the process has no ring or it can no longer be pinned. */
+int
+aio_enter (unsigned to_submit, unsigned min_complete)
+{
+  struct thread *cur = thread_current ();
+  struct aio_ctx *ctx = cur->aio;
+  struct aio_ring *ring;
+  unsigned idx[3]; /* sq_head, sq_tail, cq_head. */
+  unsigned ready;
+
+  if (ctx == NULL
+      || !pin_user_range (ctx->pagedir, ctx->ring, sizeof *ctx->ring, true))
+    return -1;
+  ring = ctx->ring;
+  copy_in (ctx->pagedir, idx, &ring->sq_head, sizeof idx);
+
+  for (; to_submit > 0 && idx[0] != idx[1]; to_submit--, idx[0]++)
+    {
+      struct aio_sqe sqe;
+      struct aio_work *w;
+      struct file *f;
+
+      lock_acquire (&ctx->lock);
+      bool full = ctx->cq_tail - idx[2] + ctx->inflight >= AIO_RING_SIZE;
+      lock_release (&ctx->lock);
+      if (full)
+        break;
+
+      copy_in (ctx->pagedir, &sqe, &ring->sq[idx[0] % AIO_RING_SIZE],
+               sizeof sqe);
+      f = fd_table_getf (&cur->fd_table, sqe.fd);
+      if (f == NULL || (sqe.op != AIO_READ && sqe.op != AIO_WRITE)
+          || (w = malloc (sizeof *w)) == NULL)
+        {
+          post (ctx, sqe.data, -1, false);
+          continue;
+        }
+      // the fd may be closed before the request is served
+      w->file = file_reopen (f);
+      if (w->file == NULL
+          || !pin_user_range (ctx->pagedir, sqe.buf, sqe.size,
+                              sqe.op == AIO_READ))
+        {
+          file_close (w->file);
+          free (w);
+          post (ctx, sqe.data, -1, false);
+          continue;
+        }
+      // for the completion, posted by a worker; cannot fail, since
+      // the ring is pinned already
+      pin_user_range (ctx->pagedir, ring, sizeof *ring, true);
+      w->ctx = ctx;
+      w->rusage = &cur->rusage;
+      w->sqe = sqe;
+
+      lock_acquire (&ctx->lock);
+      ctx->inflight++;
+      lock_release (&ctx->lock);
+      lock_acquire (&work_lock);
+      list_push_back (&work_queue, &w->elem);
+      cond_signal (&work_ready, &work_lock);
+      lock_release (&work_lock);
+    }
+  copy_out (ctx->pagedir, &ring->sq_head, &idx[0], sizeof idx[0]);
+
+  lock_acquire (&ctx->lock);
+  for (;;)
+    {
+      copy_in (ctx->pagedir, &idx[2], &ring->cq_head, sizeof idx[2]);
+      ready = ctx->cq_tail - idx[2];
+      if (ready >= min_complete || ctx->inflight == 0)
+        break;
+      cond_wait (&ctx->done, &ctx->lock);
+    }
+  lock_release (&ctx->lock);
+  unpin_user_range (ctx->pagedir, ring, sizeof *ring);
+  return ready;
+}
+
+/* Waits for the current process's requests in flight, which
+   use its memory through the kernel, so that its pages can be
+   unmapped or shared copy-on-write. */
+void
+aio_wait (void)
+{
+  struct aio_ctx *ctx = thread_current ()->aio;
+
+  if (ctx == NULL)
+    return;
+  lock_acquire (&ctx->lock);
+  while (ctx->inflight > 0)
+    cond_wait (&ctx->done, &ctx->lock);
+  lock_release (&ctx->lock);
+}
+
+/* Waits for the current process's requests in flight and frees
+   its asynchronous I/O state.  Must be called before its page
+   directory is destroyed. */
+void
+aio_exit (void)
+{
+  struct thread *cur = thread_current ();
+
+  aio_wait ();
+  free (cur->aio);
+  cur->aio = NULL;
+}
+
+/* Starts the worker threads, the first time a process sets up a
+   ring. */
+static void
+start_workers (void)
+{
+  static bool started;
+  enum intr_level old_level = intr_disable ();
+  bool start = !started;
+  started = true;
+  intr_set_level (old_level);
+
+  if (!start)
+    return;
+  list_init (&work_queue);
+  lock_init (&work_lock);
+  cond_init (&work_ready);
+  for (int i = 0; i < AIO_WORKERS; i++)
+    thread_create ("aio", PRI_DEFAULT, aio_worker, NULL);
+}
+
+/* Worker thread: serves requests from work_queue one at a time,
+   through a kernel buffer a page at a time, and posts their
+   completions. */
+static void
+aio_worker (void *aux UNUSED)
+{
+  uint8_t *bounce = palloc_get_page (PAL_ASSERT);
+
+  for (;;)
+    {
+      struct aio_work *w;
+
+      lock_acquire (&work_lock);
+      while (list_empty (&work_queue))
+        cond_wait (&work_ready, &work_lock);
+      w = list_entry (list_pop_front (&work_queue), struct aio_work, elem);
+      lock_release (&work_lock);
+
+      struct aio_sqe *sqe = &w->sqe;
+      uint32_t *pd = w->ctx->pagedir;
+      unsigned done = 0;
+      int result = 0;
+      while (done < sqe->size)
+        {
+          unsigned chunk
+              = sqe->size - done < PGSIZE ? sqe->size - done : PGSIZE;
+          int n;
+          if (sqe->op == AIO_READ)
+            {
+              n = file_read_at (w->file, bounce, chunk, sqe->offset + done);
+              if (n > 0
+                  && !copy_out (pd, (uint8_t *)sqe->buf + done, bounce, n))
+                n = -1;
+            }
+          else if (copy_in (pd, bounce, (uint8_t *)sqe->buf + done, chunk))
+            n = file_write_at (w->file, bounce, chunk, sqe->offset + done);
+          else
+            n = -1;
+          if (n < 0)
+            {
+              result = -1;
+              break;
+            }
+          file_charge (sqe->op == AIO_READ ? &w->rusage->bytes_read
+                                           : &w->rusage->bytes_written,
+                       n);
+          done += n;
+          result = done;
+          if ((unsigned)n < chunk)
+            break;
+        }
+      file_close (w->file);
+      unpin_user_range (pd, sqe->buf, sqe->size);
+      post (w->ctx, sqe->data, result, true);
+      free (w);
+    }
+}
+
+/* Makes sure that the SIZE bytes at user address UADDR are pages
+   of the current process, whose page directory is PD, and
+   writable if WRITABLE is true, and keeps them in memory until
+   unpin_user_range(), so that workers can reach them.  Pages not
+   loaded yet are loaded, and writable pages shared copy-on-write
+   are made private.  An empty range pins nothing, wherever it
+   is.  Returns false if a page is missing or read-only, or cannot
+   be loaded. */
+static bool
+pin_user_range (uint32_t *pd, const void *uaddr, size_t size,
+                bool writable)
+{
+  const uint8_t *start = pg_round_down (uaddr);
+  const uint8_t *end = (const uint8_t *)uaddr + size;
+  const uint8_t *p;
+
+  if (size == 0)
+    return true;
+  if (end < (const uint8_t *)uaddr || !is_user_vaddr (end - 1))
+    return false;
+  for (p = start; p < end; p += PGSIZE)
+    {
+#ifdef VM
+      if (!vm_sup_page_pin (thread_current ()->supplemental_table, pd,
+                            (void *)p, writable))
+        break;
+#else
+      if (pagedir_get_page (pd, p) == NULL
+          || (writable && !pagedir_is_writable (pd, p)))
+        break;
+#endif
+    }
+  if (p >= end)
+    return true;
+  unpin_user_range (pd, start, p - start);
+  return false;
+}
+
+/* Lets the SIZE bytes at user address UADDR in PD, pinned by
+   pin_user_range(), be evicted again. */
+static void
+unpin_user_range (uint32_t *pd UNUSED, const void *uaddr UNUSED,
+                  size_t size UNUSED)
+{
+#ifdef VM
+  const uint8_t *end = (const uint8_t *)uaddr + size;
+
+  if (size == 0)
+    return;
+  for (const uint8_t *p = pg_round_down (uaddr); p < end; p += PGSIZE)
+    vm_sup_page_unpin (pd, (void *)p);
+#endif
+}
+
+/* Copies SIZE bytes from SRC to user address UDST in PD, which
+   need not be the active page directory.  Returns false if part
+   of the range is not in memory, which does not happen to a range
+   pinned by pin_user_range(). */
+static bool
+copy_out (uint32_t *pd, void *udst, const void *src, size_t size)
+{
+  uint8_t *dst = udst;
+  const uint8_t *s = src;
+
+  while (size > 0)
+    {
+      size_t chunk = PGSIZE - pg_ofs (dst);
+      if (chunk > size)
+        chunk = size;
+      uint8_t *kpage = pagedir_get_page (pd, dst);
+      if (kpage == NULL)
+        return false;
+      memcpy (kpage, s, chunk);
+      // the write bypasses the user mapping, which would not record it
+      pagedir_set_dirty (pd, dst, true);
+      dst += chunk;
+      s += chunk;
+      size -= chunk;
+    }
+  return true;
+}
+
+/* Copies SIZE bytes from user address USRC in PD, which need not
+   be the active page directory, to DST.  Returns false if part of
+   the range is not in memory, which does not happen to a range
+   pinned by pin_user_range(). */
+static bool
+copy_in (uint32_t *pd, void *dst, const void *usrc, size_t size)
+{
+  uint8_t *d = dst;
+  const uint8_t *src = usrc;
+
+  while (size > 0)
+    {
+      size_t chunk = PGSIZE - pg_ofs (src);
+      if (chunk > size)
+        chunk = size;
+      const uint8_t *kpage = pagedir_get_page (pd, src);
+      if (kpage == NULL)
+        return false;
+      memcpy (d, kpage, chunk);
+      d += chunk;
+      src += chunk;
+      size -= chunk;
+    }
+  return true;
+}
+
+/* Posts a completion with DATA and RESULT to CTX's ring, which
+   must be pinned.  If SERVED, the request was served by a worker
+   and is no longer in flight, and the pin it held on the ring is
+   dropped. */
+static void
+post (struct aio_ctx *ctx, unsigned data, int result, bool served)
+{
+  struct aio_cqe cqe = { data, result };
+
+  lock_acquire (&ctx->lock);
+  copy_out (ctx->pagedir, &ctx->ring->cq[ctx->cq_tail % AIO_RING_SIZE],
+            &cqe, sizeof cqe);
+  ctx->cq_tail++;
+  copy_out (ctx->pagedir, &ctx->ring->cq_tail, &ctx->cq_tail,
+            sizeof ctx->cq_tail);
+  if (served)
+    {
+      unpin_user_range (ctx->pagedir, ctx->ring, sizeof *ctx->ring);
+      ctx->inflight--;
+    }
+  cond_broadcast (&ctx->done, &ctx->lock);
+  lock_release (&ctx->lock);
+}
+
+#endif /* FILESYS */
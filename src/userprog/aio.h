@@ -0,0 +1,14 @@
+#ifndef USERPROG_AIO_H
+#define USERPROG_AIO_H
+
+#include <aio.h>
+#include <stdbool.h>
+
+/* Asynchronous file I/O for user processes. */
+
+bool aio_setup (struct aio_ring *);
+int aio_enter (unsigned to_submit, unsigned min_complete);
+void aio_wait (void);
+void aio_exit (void);
+
+#endif /* userprog/aio.h */
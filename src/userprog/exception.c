@@ -5,6 +5,10 @@
 #include "userprog/process.h"
 #include <inttypes.h>
 #include <stdio.h>
+#ifdef VM
+#include "threads/vaddr.h"
+#include "vm/sup_page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -161,6 +165,31 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* A page the process has but that is not loaded yet, or was
+     evicted.  Kernel accesses to user memory load it too. */
+  struct thread *cur = thread_current ();
+  if (not_present && is_user_vaddr (fault_addr)
+      && cur->supplemental_table != NULL
+      && vm_sup_page_load_page (cur->supplemental_table, cur->pagedir,
+                                pg_round_down (fault_addr)))
+    return;
+  /* A write to a page shared copy-on-write with a forked
+     process. */
+  if (!not_present && write && is_user_vaddr (fault_addr)
+      && cur->supplemental_table != NULL
+      && vm_sup_page_unshare (cur->supplemental_table, cur->pagedir,
+                              pg_round_down (fault_addr)))
+    return;
+  /* An access just below the stack pointer: grow the stack.  In
+     the kernel, use the stack pointer saved at system call entry,
+     since F's is the kernel's. */
+  if (not_present && cur->supplemental_table != NULL
+      && vm_sup_page_grow_stack (cur->supplemental_table, cur->pagedir,
+                                 fault_addr, user ? f->esp : cur->user_esp))
+    return;
+#endif
+
   /* See section [3.1.5]
      a page fault in the kernel merely sets eax to 0xffffffff
      and copies its former value into eip */
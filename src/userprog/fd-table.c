@@ -0,0 +1,176 @@
+#include "userprog/fd-table.h"
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <string.h>
+
+/* fds 0 and 1 are the console and never in the table. */
+#define FD_FIRST 2
+
+/* Entries in a table's first allocation. */
+#define FD_INIT_SIZE 16
+
+/* initialize an empty fd table */
+void
+fd_table_init (struct fd_table *ft)
+{
+  ft->entries = NULL;
+  ft->size = 0;
+  ft->used = NULL;
+}
+
+/* close every fd and free the fd table */
+void
+fd_table_clear (struct fd_table *ft)
+{
+  for (size_t fd = FD_FIRST; fd < ft->size; fd++)
+    if (bitmap_test (ft->used, fd))
+      fd_table_remove (ft, fd);
+  free (ft->entries);
+  if (ft->used != NULL)
+    bitmap_destroy (ft->used);
+  fd_table_init (ft);
+}
+
+/* Doubles the size of FT.  Returns false if out of memory. */
+static bool
+grow (struct fd_table *ft)
+{
+  size_t new_size = ft->size ? ft->size * 2 : FD_INIT_SIZE;
+  struct fd_entry *entries
+      = realloc (ft->entries, new_size * sizeof *ft->entries);
+  if (entries == NULL)
+    return false;
+  ft->entries = entries;
+
+  struct bitmap *used = bitmap_create (new_size);
+  if (used == NULL)
+    return false;
+  // the console fds are never free
+  bitmap_set_multiple (used, 0, FD_FIRST, true);
+  for (size_t fd = FD_FIRST; fd < ft->size; fd++)
+    bitmap_set (used, fd, bitmap_test (ft->used, fd));
+  if (ft->used != NULL)
+    bitmap_destroy (ft->used);
+  ft->used = used;
+  ft->size = new_size;
+  return true;
+}
+
+/* Makes DST, an empty table, a copy of SRC: each fd of SRC is
+   open in DST on the same file or directory, at the same file
+   position.  Returns false if out of memory; the fds copied so
+   far stay open in DST then. */
+bool
+fd_table_dup (struct fd_table *dst, struct fd_table *src)
+{
+  ASSERT (dst->size == 0);
+  while (dst->size < src->size)
+    if (!grow (dst))
+      return false;
+
+  for (size_t fd = FD_FIRST; fd < src->size; fd++)
+    if (bitmap_test (src->used, fd))
+      {
+        struct fd_entry *e = &dst->entries[fd];
+        e->f = NULL;
+        e->d = NULL;
+        if (src->entries[fd].f != NULL)
+          {
+            e->f = file_reopen (src->entries[fd].f);
+            if (e->f == NULL)
+              return false;
+            file_seek (e->f, file_tell (src->entries[fd].f));
+          }
+        else
+          {
+            e->d = dir_reopen (src->entries[fd].d);
+            if (e->d == NULL)
+              return false;
+          }
+        bitmap_mark (dst->used, fd);
+      }
+  return true;
+}
+
+/* Stores F and D in the lowest free fd of FT and returns it, or
+   -1 if out of memory. */
+static int
+insert (struct fd_table *ft, struct file *f, struct dir *d)
+{
+  size_t fd = ft->used != NULL ? bitmap_scan_and_flip (ft->used, FD_FIRST, 1,
+                                                       false)
+                               : BITMAP_ERROR;
+  if (fd == BITMAP_ERROR)
+    {
+      fd = ft->size > FD_FIRST ? ft->size : FD_FIRST;
+      if (!grow (ft))
+        return -1;
+      bitmap_mark (ft->used, fd);
+    }
+  ft->entries[fd].f = f;
+  ft->entries[fd].d = d;
+  return fd;
+}
+
+/* insert a new file, allocate fd */
+int
+fd_table_insertf (struct fd_table *ft, struct file *f)
+{
+  ASSERT (f != NULL);
+  return insert (ft, f, NULL);
+}
+
+/* insert a new dir, allocate fd */
+int
+fd_table_insertd (struct fd_table *ft, struct dir *d)
+{
+  ASSERT (d != NULL);
+  return insert (ft, NULL, d);
+}
+
+/* Returns the entry for FD in FT, or NULL if FD is not open. */
+static struct fd_entry *
+lookup (struct fd_table *ft, int fd)
+{
+  if (fd < FD_FIRST || (size_t)fd >= ft->size || !bitmap_test (ft->used, fd))
+    return NULL;
+  return &ft->entries[fd];
+}
+
+/* Get the file structure associated with the fd.
+  return NULL if the given fd doesn't exist.
+*/
+struct file *
+fd_table_getf (struct fd_table *ft, int fd)
+{
+  struct fd_entry *e = lookup (ft, fd);
+  return e != NULL ? e->f : NULL;
+}
+
+/* Get the dir structure associated with the fd.
+  return NULL if the given fd doesn't exist.
+*/
+struct dir *
+fd_table_getd (struct fd_table *ft, int fd)
+{
+  struct fd_entry *e = lookup (ft, fd);
+  return e != NULL ? e->d : NULL;
+}
+
+/* remove and close the fd */
+void
+fd_table_remove (struct fd_table *ft, int fd)
+{
+  // invalid fd, cannot close stdin/stdout
+  struct fd_entry *e = lookup (ft, fd);
+  if (e == NULL)
+    return;
+  if (e->f)
+    file_close (e->f);
+  if (e->d)
+    dir_close (e->d);
+  bitmap_reset (ft->used, fd);
+}
@@ -0,0 +1,44 @@
+#ifndef USERPROG_FD_TABLE_H
+#define USERPROG_FD_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct file;
+struct dir;
+
+// An open file or directory in a descriptor table.
+struct fd_entry
+{
+  struct file *f; // file
+  struct dir *d;  // directory
+};
+
+// The table of open files and directories of a process, indexed
+// by fd.  Lookups are O(1); the lowest free fd is found through a
+// bitmap of the entries in use.
+struct fd_table
+{
+  struct fd_entry *entries; // entries, NULL until the first open
+  size_t size;              // number of entries allocated
+  struct bitmap *used;      // which entries are in use
+};
+
+/* initialize an empty fd table */
+void fd_table_init (struct fd_table *ft);
+/* close every fd and free the fd table */
+void fd_table_clear (struct fd_table *ft);
+/* Make empty table DST a copy of SRC, or return false if out of memory */
+bool fd_table_dup (struct fd_table *dst, struct fd_table *src);
+/* Insert new file and get proper fd, or -1 if out of memory */
+int fd_table_insertf (struct fd_table *ft, struct file *f);
+/* Insert new directory and get proper fd, or -1 if out of memory */
+int fd_table_insertd (struct fd_table *ft, struct dir *d);
+/* Get the file with specified fd */
+struct file *fd_table_getf (struct fd_table *ft, int fd);
+/* Get the directory with specified fd */
+struct dir *fd_table_getd (struct fd_table *ft, int fd);
+/* close and remove the fd */
+void fd_table_remove (struct fd_table *ft, int fd);
+
+#endif /* userprog/fd-table.h */
@@ -3,6 +3,7 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "lib/string.h"
 #include "threads/flags.h"
 #include "threads/init.h"
@@ -10,6 +11,7 @@
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "userprog/aio.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
@@ -19,10 +21,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <wait.h>
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/sup_page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool load (const char *cmdline, void (**eip) (void), void **esp,
+                  size_t stack_size);
+
+static struct proc_record *proc_create (void);
+static void proc_free (struct proc_record *);
+static void proc_release_children (struct proc_record *);
+static int proc_reap (struct proc_record *);
+static hash_hash_func proc_hash;
+static hash_less_func proc_less;
+
+static struct lock image_cache_lock;
 
+static size_t stack_size (const char *name, const char *args);
 static void prepare_stack (void **esp, char *name, char *args);
 static void esp_push_align (void **esp_);
 static void esp_push_u32 (void **esp_, uint32_t val);
@@ -37,6 +55,13 @@ struct child_arg
   bool load_failed;            // whether load ELF has succeeded
 };
 
+/* Initializes the process loader. */
+void
+process_init (void)
+{
+  lock_init (&image_cache_lock);
+}
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -55,28 +80,32 @@ process_execute (const char *file_name)
   // remember to deallocate on this kernel thread exit
   if (cur->proc == NULL)
     {
-      cur->proc = (struct proc_record *)palloc_get_page (0);
-      ASSERT (cur->proc);
-      proc_init (cur->proc);
+      cur->proc = proc_create ();
+      if (cur->proc == NULL)
+        return TID_ERROR;
       cur->proc->orphan = true;
     }
 
   /* Make a copy of FILE_NAME.
      Otherwise there's a race between the caller and load(). */
-  ch_arg.fn_copy = palloc_get_page (0);
+  size_t fn_size = strlen (file_name) + 1;
+  ch_arg.fn_copy = malloc (fn_size);
   if (ch_arg.fn_copy == NULL)
     return TID_ERROR;
-  strlcpy (ch_arg.fn_copy, file_name, PGSIZE);
+  memcpy (ch_arg.fn_copy, file_name, fn_size);
 
   /* Create a new thread to execute FILE_NAME. */
   tid_t tid = thread_create (file_name, PRI_DEFAULT, start_process, &ch_arg);
   // on thread create error
   if (tid == TID_ERROR)
-    return -1;
+    {
+      free (ch_arg.fn_copy);
+      return -1;
+    }
   // make sure that parent process won't exit before child creation finished
   sema_down (&ch_arg.sema_start);
   // deallocate the file name copy
-  palloc_free_page (ch_arg.fn_copy);
+  free (ch_arg.fn_copy);
   // start process function failed to load ELF executable
   if (ch_arg.load_failed)
     return -1;
@@ -110,18 +139,28 @@ start_process (void *ch_arg_)
   strlcpy (cur->name, file_name, strlen (file_name) + 1);
 
   // create the process control data structures
-  cur->proc = (struct proc_record *)palloc_get_page (0);
-  ASSERT (cur->proc);
-  proc_init (cur->proc);
+  cur->proc = proc_create ();
+  if (cur->proc == NULL)
+    {
+      ch_arg->load_failed = true;
+      sema_up (&ch_arg->sema_start);
+      thread_exit ();
+    }
   // load the ELF binary executable file from FS
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = load (file_name, &if_.eip, &if_.esp,
+                  stack_size (file_name, args));
   if (success)
     prepare_stack (&if_.esp, file_name, args);
   else
     ch_arg->load_failed = true;
 
-  // insert child process record pointer for parent
-  proc_add_child (ch_arg->parent->proc, cur->proc);
+  // insert child process record pointer for parent.  The parent
+  // never waits for a process that failed to load, which
+  // deallocates its own record instead.
+  if (success)
+    proc_add_child (ch_arg->parent->proc, cur->proc);
+  else
+    cur->proc->orphan = true;
   // notify the parent that the child process is ready
   sema_up (&ch_arg->sema_start);
 
@@ -148,6 +187,105 @@ start_process (void *ch_arg_)
   NOT_REACHED ();
 }
 
+#ifdef VM
+/* arguments for the start_fork thread function */
+struct fork_arg
+{
+  struct thread *parent;       // the forking process
+  struct intr_frame if_;       // its user registers at the fork() call
+  struct semaphore sema_start; // up when the child has been set up
+  bool failed;                 // whether duplicating the process failed
+};
+
+static thread_func start_fork NO_RETURN;
+
+/* Creates a copy of the current process, which returns from the
+   fork() system call with 0.  The copy shares the process's pages
+   copy-on-write and has its files open.  Returns the new process's
+   thread id, or TID_ERROR if it cannot be created. */
+tid_t
+process_fork (void)
+{
+  struct thread *cur = thread_current ();
+  struct fork_arg arg;
+
+  arg.parent = cur;
+  // entering the kernel from user mode saved the user's registers
+  // at the top of the kernel stack
+  arg.if_ = ((struct intr_frame *)((uint8_t *)cur + PGSIZE))[-1];
+  sema_init (&arg.sema_start, 0);
+  arg.failed = false;
+#ifdef FILESYS
+  // requests in flight write to pages about to be shared
+  aio_wait ();
+#endif
+
+  tid_t tid = thread_create (cur->name, PRI_DEFAULT, start_fork, &arg);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+  // the child copies our address space, which must not change meanwhile
+  sema_down (&arg.sema_start);
+  return arg.failed ? TID_ERROR : tid;
+}
+
+/* A thread function that makes the current thread a copy of the
+   process that called process_fork() and starts it running. */
+static void
+start_fork (void *arg_)
+{
+  struct fork_arg *arg = arg_;
+  struct thread *parent = arg->parent, *cur = thread_current ();
+  struct intr_frame if_ = arg->if_;
+  bool success = false;
+
+  cur->proc = proc_create ();
+  if (cur->proc != NULL)
+    cur->pagedir = pagedir_create ();
+  if (cur->pagedir == NULL)
+    {
+      arg->failed = true;
+      sema_up (&arg->sema_start);
+      thread_exit ();
+    }
+
+  cur->supplemental_table = vm_sup_page_create ();
+  if (cur->supplemental_table != NULL)
+    {
+      process_activate ();
+      cur->proc->image = file_reopen (parent->proc->image);
+      if (cur->proc->image != NULL)
+        {
+          file_deny_write (cur->proc->image);
+          success = vm_sup_page_fork (cur->supplemental_table, cur->pagedir,
+                                      parent, cur->proc->image)
+                    && fd_table_dup (&cur->fd_table, &parent->fd_table);
+        }
+    }
+  if (parent->working_directory != NULL)
+    cur->working_directory = dir_reopen (parent->working_directory);
+
+  // insert child process record pointer for parent
+  if (success)
+    proc_add_child (parent->proc, cur->proc);
+  else
+    cur->proc->orphan = true;
+  arg->failed = !success;
+  sema_up (&arg->sema_start);
+
+  if (!success)
+    {
+      cur->proc->proc_status = PROC_ERROR_EXIT;
+      cur->proc->exit_code = -1;
+      thread_exit ();
+    }
+
+  // fork() returns 0 in the child
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g"(&if_) : "memory");
+  NOT_REACHED ();
+}
+#endif
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -166,14 +304,43 @@ process_wait (tid_t tid)
     return -1;
   // wait for child process exit
   sema_down (&child_proc->sema_exit);
-  int code = child_proc->exit_code, reason = child_proc->proc_status;
-  // deallocate resources in proc_record for the child
-  proc_remove_child (child_proc);
-  palloc_free_page ((void *)child_proc);
-  // the child process was killed by kernel on exception, return -1
-  if (reason == PROC_ERROR_EXIT)
+  return proc_reap (child_proc);
+}
+
+/* Waits for whichever child of the current process exits first,
+   or has already exited without being waited for, and stores its
+   exit status, as process_wait() would return it, in *STATUS.
+   With WNOHANG in FLAGS, returns 0 at once if no child has exited
+   yet.  Returns the child's thread id, or -1 if there are no
+   children left to wait for. */
+tid_t
+process_wait_any (int *status, int flags)
+{
+  struct proc_record *proc = proc_current ();
+  struct proc_record *child = NULL;
+
+  if (proc == NULL)
     return -1;
-  return code;
+  for (;;)
+    {
+      enum intr_level old = intr_disable ();
+      if (!list_empty (&proc->done))
+        child = list_entry (list_front (&proc->done), struct proc_record,
+                            done_elem);
+      intr_set_level (old);
+      if (child != NULL)
+        break;
+      if (hash_empty (&proc->children))
+        return -1;
+      if (flags & WNOHANG)
+        return 0;
+      // also up for children reaped by process_wait(), so check again
+      sema_down (&proc->sema_child);
+    }
+
+  tid_t tid = child->id;
+  *status = proc_reap (child);
+  return tid;
 }
 
 /* Free the current process's resources. */
@@ -187,33 +354,44 @@ process_exit (void)
     {
       // deallocate the process record if previously allocated
       if (cur->proc != NULL)
-        palloc_free_page (cur->proc);
+        {
+          proc_release_children (cur->proc);
+          proc_free (cur->proc);
+        }
       cur->proc = NULL;
       return;
     }
 
+  // pending output comes before the exit message
+  process_console_flush ();
+  free (cur->console_buf);
+  cur->console_buf = NULL;
+
   // print the process exit message
   printf ("%s: exit(%d)\n", cur->name, cur->proc->exit_code);
 
-  // possible race: child exit + parent exit interleaved
-  enum intr_level old = intr_disable ();
-  // deallocate the proc record for already exited children,
-  // set running children to be orphan.
-  for (int i = 0; i < MAX_CHS; i++)
-    {
-      struct proc_record *ch_proc = cur->proc->children[i];
-      if (ch_proc != NULL)
-        {
-          if (ch_proc->proc_status == PROC_RUNNING)
-            ch_proc->orphan = true;
-          else
-            palloc_free_page ((void *)ch_proc);
-        }
-    }
-  intr_set_level (old);
+  proc_release_children (cur->proc);
 
 #ifdef FILESYS
-  fd_list_clear (&thread_current ()->fd_list);
+  aio_exit ();
+  fd_table_clear (&thread_current ()->fd_table);
+#endif
+
+#ifdef VM
+  // write back and drop the mappings, then the pages not in pagedir
+  while (!list_empty (&cur->mmap_list))
+    {
+      struct mmap_entry *m = list_entry (list_pop_front (&cur->mmap_list),
+                                         struct mmap_entry, elem);
+      vm_sup_page_unmap (cur->supplemental_table, m->addr, m->pages);
+      free (m);
+    }
+  if (cur->supplemental_table != NULL)
+    {
+      vm_sup_page_destroy (cur->supplemental_table);
+      free (cur->supplemental_table);
+      cur->supplemental_table = NULL;
+    }
 #endif
 
   /* Destroy the current process's page directory and switch back to the
@@ -237,15 +415,59 @@ process_exit (void)
       file_close (cur->proc->image);
     }
 
+  // possible race: child exit + parent exit interleaved
+  enum intr_level old = intr_disable ();
   // notify parent thread that the children have exitted
+  cur->proc->exited = true;
   sema_up (&cur->proc->sema_exit);
-
   // orphran deallocate process record structure
   if (cur->proc->orphan)
-    palloc_free_page ((void *)cur->proc);
+    proc_free (cur->proc);
+  else
+    {
+      list_push_back (&cur->proc->parent->done, &cur->proc->done_elem);
+      sema_up (&cur->proc->parent->sema_child);
+    }
+  intr_set_level (old);
   cur->proc = NULL;
 }
 
+/* Writes the N bytes in BUFFER to the console on behalf of the
+   current process.  Output is collected in a per-process buffer
+   and reaches the console in chunks, taking the console lock
+   once per chunk.  Falls back to writing directly if the buffer
+   cannot be allocated. */
+void
+process_console_write (const char *buffer, size_t n)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->console_buf == NULL)
+    cur->console_buf = malloc (CONSOLE_BUF_SIZE);
+  if (cur->console_len + n > CONSOLE_BUF_SIZE)
+    process_console_flush ();
+  if (cur->console_buf == NULL || n > CONSOLE_BUF_SIZE)
+    {
+      putbuf (buffer, n);
+      return;
+    }
+  memcpy (cur->console_buf + cur->console_len, buffer, n);
+  cur->console_len += n;
+}
+
+/* Writes out the current process's buffered console output. */
+void
+process_console_flush (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->console_len > 0)
+    {
+      putbuf (cur->console_buf, cur->console_len);
+      cur->console_len = 0;
+    }
+}
+
 /* Sets up the CPU for running user code in the current
    thread.
    This function is called on every context switch. */
@@ -325,7 +547,28 @@ struct Elf32_Phdr
 #define PF_W 2 /* Writable. */
 #define PF_R 4 /* Readable. */
 
-static bool setup_stack (void **esp);
+/* A loadable segment of an executable, as load_segment() takes
+   it. */
+struct image_segment
+{
+  uint32_t file_page;  /* Offset of the first page in the file. */
+  uint32_t mem_page;   /* User address of the first page. */
+  uint32_t read_bytes; /* Bytes to read from the file. */
+  uint32_t zero_bytes; /* Bytes to zero after them. */
+  bool writable;       /* Mapped writable? */
+};
+
+/* What load() needs from an executable's headers. */
+struct image
+{
+  Elf32_Addr entry;               /* Entry point. */
+  int segment_cnt;                /* Number of loadable segments. */
+  struct image_segment *segments; /* Loadable segments, malloc()ed. */
+};
+
+static bool setup_stack (void **esp, size_t size);
+static bool read_image (struct file *, struct image *);
+static bool read_image_headers (struct file *, struct image *);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
@@ -333,15 +576,16 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 
 /* Loads an ELF executable from FILE_NAME into the current thread.
    Stores the executable's entry point into *EIP
-   and its initial stack pointer into *ESP.
+   and its initial stack pointer into *ESP, with at least
+   STACK_SIZE bytes of stack mapped below it.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp)
+load (const char *file_name, void (**eip) (void), void **esp,
+      size_t stack_size)
 {
   struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
+  struct image image = { 0, 0, NULL };
   struct file *file = NULL;
-  off_t file_ofs;
   bool success = false;
   int i;
 
@@ -349,6 +593,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL)
     goto done;
+#ifdef VM
+  t->supplemental_table = vm_sup_page_create ();
+  if (t->supplemental_table == NULL)
+    goto done;
+#endif
   process_activate ();
 
   /* Open executable file. */
@@ -360,86 +609,34 @@ load (const char *file_name, void (**eip) (void), void **esp)
     }
   file_deny_write (file);
 
-  /* Read and verify executable header. */
-  if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
-      || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7) || ehdr.e_type != 2
-      || ehdr.e_machine != 3 || ehdr.e_version != 1
-      || ehdr.e_phentsize != sizeof (struct Elf32_Phdr) || ehdr.e_phnum > 1024)
+  /* Read and verify executable and program headers. */
+  if (!read_image (file, &image))
     {
       printf ("load: %s: error loading executable\n", file_name);
       goto done;
     }
 
-  /* Read program headers. */
-  file_ofs = ehdr.e_phoff;
-  for (i = 0; i < ehdr.e_phnum; i++)
+  /* Load the segments. */
+  for (i = 0; i < image.segment_cnt; i++)
     {
-      struct Elf32_Phdr phdr;
-
-      if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
-      file_seek (file, file_ofs);
-
-      if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
+      struct image_segment *seg = &image.segments[i];
+      if (!load_segment (file, seg->file_page, (void *)seg->mem_page,
+                         seg->read_bytes, seg->zero_bytes, seg->writable))
         goto done;
-      file_ofs += sizeof phdr;
-      switch (phdr.p_type)
-        {
-        case PT_NULL:
-        case PT_NOTE:
-        case PT_PHDR:
-        case PT_STACK:
-        default:
-          /* Ignore this segment. */
-          break;
-        case PT_DYNAMIC:
-        case PT_INTERP:
-        case PT_SHLIB:
-          goto done;
-        case PT_LOAD:
-          if (validate_segment (&phdr, file))
-            {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
-              uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
-              if (phdr.p_filesz > 0)
-                {
-                  /* Normal segment.
-                     Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
-                }
-              else
-                {
-                  /* Entirely zero.
-                     Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
-                }
-              if (!load_segment (file, file_page, (void *)mem_page, read_bytes,
-                                 zero_bytes, writable))
-                goto done;
-            }
-          else
-            goto done;
-          break;
-        }
     }
 
   /* Set up stack. */
-  if (!setup_stack (esp))
+  if (!setup_stack (esp, stack_size))
     goto done;
 
   /* Start address. */
-  *eip = (void (*) (void))ehdr.e_entry;
+  *eip = (void (*) (void))image.entry;
 
   success = true;
 
 done:
   /* We arrive here whether the load is successful or not. */
+  free (image.segments);
   if (success)
     {
       proc_current ()->image = file;
@@ -457,6 +654,153 @@ done:
 
 static bool install_page (void *upage, void *kpage, bool writable);
 
+/* Number of executables whose headers are cached. */
+#define IMAGE_CACHE_SIZE 8
+
+/* A verified executable's entry point and segment list, valid
+   while the executable's inode has the same version. */
+struct image_cache_entry
+{
+  block_sector_t sector; /* Inode sector of the executable. */
+  unsigned version;      /* inode_version() when cached; 0 if unused. */
+  struct image image;
+};
+
+static struct image_cache_entry image_cache[IMAGE_CACHE_SIZE];
+static unsigned image_cache_hand; /* Next entry to replace. */
+
+/* Returns a malloc()ed copy of IMAGE's segment list, or a null
+   pointer if out of memory. */
+static struct image_segment *
+copy_segments (const struct image *image)
+{
+  size_t size = image->segment_cnt * sizeof *image->segments;
+  struct image_segment *segments = malloc (size > 0 ? size : 1);
+  if (segments != NULL)
+    memcpy (segments, image->segments, size);
+  return segments;
+}
+
+/* Reads FILE's executable and program headers into *IMAGE and
+   verifies them.  Returns true if successful, false otherwise;
+   either way the caller must free IMAGE->segments.  A process
+   spawning a program that was loaded before and not written since
+   finds the image in a cache instead, without reading or checking
+   any headers. */
+static bool
+read_image (struct file *file, struct image *image)
+{
+  struct inode *inode = file_get_inode (file);
+  block_sector_t sector = inode_get_inumber (inode);
+  unsigned version = inode_version (inode);
+  int i;
+
+  lock_acquire (&image_cache_lock);
+  for (i = 0; i < IMAGE_CACHE_SIZE; i++)
+    if (image_cache[i].version == version && image_cache[i].sector == sector)
+      {
+        *image = image_cache[i].image;
+        image->segments = copy_segments (&image_cache[i].image);
+        lock_release (&image_cache_lock);
+        return image->segments != NULL;
+      }
+  lock_release (&image_cache_lock);
+
+  if (!read_image_headers (file, image))
+    return false;
+
+  struct image_segment *segments = copy_segments (image);
+  if (segments == NULL)
+    return true;
+  lock_acquire (&image_cache_lock);
+  struct image_cache_entry *e = &image_cache[image_cache_hand];
+  image_cache_hand = (image_cache_hand + 1) % IMAGE_CACHE_SIZE;
+  free (e->image.segments);
+  e->sector = sector;
+  e->version = version;
+  e->image = *image;
+  e->image.segments = segments;
+  lock_release (&image_cache_lock);
+  return true;
+}
+
+/* Reads and verifies FILE's executable header and program
+   headers, building IMAGE's segment list.  Returns true if FILE
+   is a loadable executable, false otherwise. */
+static bool
+read_image_headers (struct file *file, struct image *image)
+{
+  struct Elf32_Ehdr ehdr;
+  off_t file_ofs;
+  int i;
+
+  if (file_read_at (file, &ehdr, sizeof ehdr, 0) != sizeof ehdr
+      || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7) || ehdr.e_type != 2
+      || ehdr.e_machine != 3 || ehdr.e_version != 1
+      || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
+      || ehdr.e_phnum > 1024)
+    return false;
+
+  image->entry = ehdr.e_entry;
+  image->segment_cnt = 0;
+  image->segments = malloc (ehdr.e_phnum > 0
+                                ? ehdr.e_phnum * sizeof *image->segments
+                                : 1);
+  if (image->segments == NULL)
+    return false;
+
+  file_ofs = ehdr.e_phoff;
+  for (i = 0; i < ehdr.e_phnum; i++)
+    {
+      struct Elf32_Phdr phdr;
+
+      if (file_ofs < 0 || file_ofs > file_length (file))
+        return false;
+      if (file_read_at (file, &phdr, sizeof phdr, file_ofs) != sizeof phdr)
+        return false;
+      file_ofs += sizeof phdr;
+      switch (phdr.p_type)
+        {
+        case PT_NULL:
+        case PT_NOTE:
+        case PT_PHDR:
+        case PT_STACK:
+        default:
+          /* Ignore this segment. */
+          break;
+        case PT_DYNAMIC:
+        case PT_INTERP:
+        case PT_SHLIB:
+          return false;
+        case PT_LOAD:
+          if (!validate_segment (&phdr, file))
+            return false;
+          struct image_segment *seg = &image->segments[image->segment_cnt++];
+          uint32_t page_offset = phdr.p_vaddr & PGMASK;
+          seg->writable = (phdr.p_flags & PF_W) != 0;
+          seg->file_page = phdr.p_offset & ~PGMASK;
+          seg->mem_page = phdr.p_vaddr & ~PGMASK;
+          if (phdr.p_filesz > 0)
+            {
+              /* Normal segment.
+                 Read initial part from disk and zero the rest. */
+              seg->read_bytes = page_offset + phdr.p_filesz;
+              seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+                                 - seg->read_bytes);
+            }
+          else
+            {
+              /* Entirely zero.
+                 Don't read anything from disk. */
+              seg->read_bytes = 0;
+              seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+            }
+          break;
+        }
+    }
+  return true;
+}
+
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
 static bool
@@ -533,6 +877,15 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Only record the page: it is read from FILE, which stays
+         open as the process image, the first time it is touched. */
+      if (!vm_sup_page_install_files (thread_current ()->supplemental_table,
+                                      upage, file, ofs, page_read_bytes,
+                                      writable))
+        return false;
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -552,6 +905,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false;
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -561,23 +915,53 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   return true;
 }
 
-/* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+/* Create a stack of SIZE bytes (at least a page) at the top of
+   user virtual memory.  Under VM only the top page is mapped
+   eagerly; the rest are zero pages that fault in as the command
+   line is pushed. */
 static bool
-setup_stack (void **esp)
+setup_stack (void **esp, size_t size)
 {
+  size_t pages = size > PGSIZE ? DIV_ROUND_UP (size, PGSIZE) : 1;
   uint8_t *kpage;
   bool success = false;
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (pages > (uintptr_t)PHYS_BASE / PGSIZE / 2)
+    return false;
+
+#ifdef VM
+  struct vm_sup_page_table *table = thread_current ()->supplemental_table;
+  uint8_t *upage = ((uint8_t *)PHYS_BASE) - PGSIZE;
+  kpage = vm_frame_allocate (PAL_USER | PAL_ZERO, upage);
   if (kpage != NULL)
     {
-      success = install_page (((uint8_t *)PHYS_BASE) - PGSIZE, kpage, true);
+      success = install_page (upage, kpage, true)
+                && vm_sup_page_install_page (table, upage, kpage);
       if (success)
-        *esp = PHYS_BASE;
+        {
+          vm_frame_pin_upd (kpage, false);
+          *esp = PHYS_BASE;
+        }
       else
-        palloc_free_page (kpage);
+        vm_frame_free (kpage, true);
+    }
+  for (size_t i = 1; success && i < pages; i++)
+    success = vm_sup_page_install_zero_page (table, upage - i * PGSIZE);
+#else
+  for (size_t i = 1; i <= pages; i++)
+    {
+      kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (kpage == NULL)
+        return false;
+      if (!install_page (((uint8_t *)PHYS_BASE) - i * PGSIZE, kpage, true))
+        {
+          palloc_free_page (kpage);
+          return false;
+        }
     }
+  *esp = PHYS_BASE;
+  success = true;
+#endif
   return success;
 }
 
@@ -645,8 +1029,23 @@ esp_push_ptr (void **esp_, void *ptr)
   esp_push_u32 (esp_, (uint32_t)ptr);
 }
 
+/* Returns an upper bound on the stack bytes prepare_stack() needs
+   for program NAME with argument string ARGS: both strings, word
+   alignment, one argv slot per possible token plus the name and
+   the null sentinel, then argv, argc and the return address. */
+static size_t
+stack_size (const char *name, const char *args)
+{
+  size_t args_len = strlen (args);
+  size_t max_argc = 1 + (args_len + 1) / 2;
+  return (strlen (name) + 1) + (args_len + 1) + 3
+         + sizeof (char *) * (max_argc + 1) + 3 * sizeof (uint32_t);
+}
+
 /* split arguments from command line,
    populate stakc, follow X86 call convention.
+   The argv pointers are pushed as the tokens are found and then
+   reversed in place, so there is no limit on the argument count.
 */
 static void
 prepare_stack (void **esp, char *name, char *args)
@@ -654,7 +1053,6 @@ prepare_stack (void **esp, char *name, char *args)
   ASSERT (*esp != NULL);
 
   uint32_t argc = 0;
-  char *argv[64];
 
   // copy the command line onto stack
   esp_push_str (esp, args);
@@ -662,25 +1060,31 @@ prepare_stack (void **esp, char *name, char *args)
   args = (char *)*esp;
 
   esp_push_str (esp, name);
-  argv[argc++] = (char *)*esp;
+  name = (char *)*esp;
   // word align
   esp_push_align (esp);
 
-  // split and parse arguments
-  argv[argc++] = strtok_r (args, " ", &args);
-  while (argv[argc - 1] != NULL)
+  // argv[argc] sentinel
+  esp_push_ptr (esp, NULL);
+  // push pointers to each argument, last one lowest for now
+  esp_push_ptr (esp, name);
+  argc++;
+  for (char *arg = strtok_r (args, " ", &args); arg != NULL;
+       arg = strtok_r (NULL, " ", &args))
     {
-      argv[argc++] = strtok_r (NULL, " ", &args);
+      esp_push_ptr (esp, arg);
+      argc++;
     }
-  argc--;
-
-  // push pointers to each argument (argv array)
-  for (int i = argc; i >= 0; i--)
+  // reverse them so that argv[0] is at the lowest address
+  char **argv = (char **)*esp;
+  for (uint32_t i = 0, j = argc - 1; i < j; i++, j--)
     {
-      esp_push_ptr (esp, argv[i]);
+      char *tmp = argv[i];
+      argv[i] = argv[j];
+      argv[j] = tmp;
     }
   // push pointer to the (argv array) onto stack
-  esp_push_ptr (esp, *esp);
+  esp_push_ptr (esp, argv);
   // push argc onto stack
   esp_push_u32 (esp, argc);
   // push return address
@@ -695,20 +1099,97 @@ prepare_stack (void **esp, char *name, char *args)
 /* SECTION-BEGIN: children process management */
 /* SECTION-BEGIN */
 
-/* initialize a process record */
-void
+/* Process records not in use.  Records are carved out of whole
+   pages and never given back, so that spawning a process does not
+   cost a page allocation.  Records are freed with interrupts off
+   by exiting processes, so the list is guarded by disabling
+   interrupts. */
+static struct list proc_slab = LIST_INITIALIZER (proc_slab);
+
+/* Returns a new process record for the current thread, or a
+   null pointer if out of memory. */
+static struct proc_record *
+proc_create (void)
+{
+  enum intr_level old = intr_disable ();
+  if (list_empty (&proc_slab))
+    {
+      intr_set_level (old);
+      struct proc_record *page = palloc_get_page (0);
+      if (page == NULL)
+        return NULL;
+      old = intr_disable ();
+      for (size_t i = 0; i < PGSIZE / sizeof *page; i++)
+        list_push_back (&proc_slab, &page[i].elem);
+    }
+  struct proc_record *proc
+      = list_entry (list_pop_front (&proc_slab), struct proc_record, elem);
+  intr_set_level (old);
+
+  if (!proc_init (proc))
+    {
+      proc_free (proc);
+      return NULL;
+    }
+  return proc;
+}
+
+/* Returns PROC to the free records.  May be called with
+   interrupts off. */
+static void
+proc_free (struct proc_record *proc)
+{
+  enum intr_level old = intr_disable ();
+  list_push_front (&proc_slab, &proc->elem);
+  intr_set_level (old);
+}
+
+/* initialize a process record.
+   Returns false if out of memory. */
+bool
 proc_init (struct proc_record *proc)
 {
   ASSERT (proc != NULL);
   memset ((void *)proc, 0, sizeof (struct proc_record));
   proc->id = thread_tid ();
   sema_init (&proc->sema_exit, 0);
+  list_init (&proc->done);
+  sema_init (&proc->sema_child, 0);
   proc->proc_status = PROC_RUNNING;
   proc->image = NULL;
+  if (!hash_init (&proc->children, proc_hash, proc_less, NULL))
+    return false;
 
 #ifdef FILESYS
-  list_init (&thread_current ()->fd_list);
+  fd_table_init (&thread_current ()->fd_table);
 #endif
+  return true;
+}
+
+/* Deallocates the records of PROC's children that have already
+   exited, sets the running children to be orphan, and frees the
+   children table. */
+static void
+proc_release_children (struct proc_record *proc)
+{
+  struct hash_iterator i;
+
+  // possible race: child exit + parent exit interleaved
+  enum intr_level old = intr_disable ();
+  hash_first (&i, &proc->children);
+  struct hash_elem *e = hash_next (&i);
+  while (e != NULL)
+    {
+      struct proc_record *ch_proc
+          = hash_entry (e, struct proc_record, child_elem);
+      e = hash_next (&i);
+      if (!ch_proc->exited)
+        ch_proc->orphan = true;
+      else
+        proc_free (ch_proc);
+    }
+  intr_set_level (old);
+  hash_destroy (&proc->children, NULL);
 }
 
 /* find the process whose thread id equals to the given id and return the
@@ -738,11 +1219,11 @@ proc_find_child (tid_t id)
 {
   if (thread_current ()->proc == NULL)
     return NULL;
-  struct proc_record **chs = thread_current ()->proc->children;
-  for (int i = 0; i < MAX_CHS; i++)
-    if (chs[i] && chs[i]->id == id)
-      return chs[i];
-  return NULL;
+  struct proc_record key;
+  key.id = id;
+  struct hash_elem *e
+      = hash_find (&thread_current ()->proc->children, &key.child_elem);
+  return e ? hash_entry (e, struct proc_record, child_elem) : NULL;
 }
 /* add a child process into the children filed of parent */
 void
@@ -752,155 +1233,59 @@ proc_add_child (struct proc_record *proc, struct proc_record *child)
     return;
 
   child->orphan = false;
-  struct proc_record **chs = proc->children;
-  for (int i = 0; i < MAX_CHS; i++)
-    if (chs[i] == NULL)
-      {
-        chs[i] = child;
-        return;
-      }
-  NOT_REACHED ();
+  child->parent = proc;
+  hash_insert (&proc->children, &child->child_elem);
 }
 /* add a new child process id to the children list of current thread */
 void
 proc_remove_child (struct proc_record *child_proc)
 {
-  struct proc_record **chs = thread_current ()->proc->children;
-  for (int i = 0; i < MAX_CHS; i++)
-    if (chs[i] == child_proc)
-      {
-        chs[i] = NULL;
-        return;
-      }
-  NOT_REACHED ();
+  struct hash_elem *e = hash_delete (&thread_current ()->proc->children,
+                                     &child_proc->child_elem);
+  ASSERT (e != NULL);
 }
 
-struct proc_record *
-proc_current ()
+/* Deallocates the record of CHILD, an exited child of the
+   current process, and returns its exit status as process_wait()
+   returns it. */
+static int
+proc_reap (struct proc_record *child)
 {
-  return thread_current ()->proc;
-}
-
-/* SECTION-END */
-/* SECTION-END: children process management */
-/* SECTION-END */
+  enum intr_level old = intr_disable ();
+  list_remove (&child->done_elem);
+  intr_set_level (old);
 
-/* clear the fd_list*/
-void
-fd_list_clear (struct list *fl)
-{
-  enum intr_level old_level = intr_disable ();
-  while (!list_empty (fl))
-    {
-      struct list_elem *e = list_pop_front (fl);
-      struct fd_node *fd_node = list_entry (e, struct fd_node, fd_elem);
-      if (fd_node->f)
-        file_close (fd_node->f);
-      if (fd_node->d)
-        dir_close (fd_node->d);
-      free (fd_node);
-    }
-  intr_set_level (old_level);
+  int code = child->exit_code, reason = child->proc_status;
+  // deallocate resources in proc_record for the child
+  proc_remove_child (child);
+  proc_free (child);
+  // the child process was killed by kernel on exception, return -1
+  if (reason == PROC_ERROR_EXIT)
+    return -1;
+  return code;
 }
 
-/* insert a new file, allocate fd */
-int
-fd_list_insertf (struct list *fl, struct file *f)
-{
-  ASSERT (f != NULL);
-  // Create fd_node to store file
-  struct fd_node *new_fd_entry
-      = (struct fd_node *)malloc (sizeof (struct fd_node));
-  new_fd_entry->fd = 2;
-  new_fd_entry->f = f;
-  new_fd_entry->d = NULL;
-  // Search for the first unallocated fd number.
-  struct list_elem *e = list_begin (fl);
-  for (; e != list_end (fl)
-         && new_fd_entry->fd == list_entry (e, struct fd_node, fd_elem)->fd;
-       e = list_next (e), new_fd_entry->fd++)
-    ;
-  list_insert (e, &new_fd_entry->fd_elem);
-  return new_fd_entry->fd;
-}
-
-/* insert a new dir, allocate fd */
-int
-fd_list_insertd (struct list *fl, struct dir *d)
-{
-  ASSERT (d != NULL);
-  // Create fd_node to store the directory
-  struct fd_node *new_fd_entry
-      = (struct fd_node *)malloc (sizeof (struct fd_node));
-  new_fd_entry->fd = 2;
-  new_fd_entry->f = NULL;
-  new_fd_entry->d = d;
-  // Search for the first unallocated fd number.
-  struct list_elem *e = list_begin (fl);
-  for (; e != list_end (fl)
-         && new_fd_entry->fd == list_entry (e, struct fd_node, fd_elem)->fd;
-       e = list_next (e), new_fd_entry->fd++)
-    ;
-  list_insert (e, &new_fd_entry->fd_elem);
-  return new_fd_entry->fd;
-}
-
-/* Get the file structure associated with the fd.
-  reutrn NULL if the given fd doesn't exist.
-*/
-struct file *
-fd_list_getf (struct list *fl, int fd)
+/* hash functions for the children table */
+static unsigned
+proc_hash (const struct hash_elem *e, void *aux UNUSED)
 {
-  if (fd < 2)
-    return NULL;
-  for (struct list_elem *e = list_begin (fl); e != list_end (fl);
-       e = list_next (e))
-    {
-      struct fd_node *node = list_entry (e, struct fd_node, fd_elem);
-      if (fd == node->fd)
-        return node->f;
-    }
-  return NULL;
+  return hash_int (hash_entry (e, struct proc_record, child_elem)->id);
 }
-/* Get the dir structure associated with the fd.
-  reutrn NULL if the given fd doesn't exist.
-*/
-struct dir *
-fd_list_getd (struct list *fl, int fd)
+
+static bool
+proc_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED)
 {
-  if (fd < 2)
-    return NULL;
-  for (struct list_elem *e = list_begin (fl); e != list_end (fl);
-       e = list_next (e))
-    {
-      struct fd_node *node = list_entry (e, struct fd_node, fd_elem);
-      if (fd == node->fd)
-        return node->d;
-    }
-  return NULL;
+  return hash_entry (a, struct proc_record, child_elem)->id
+         < hash_entry (b, struct proc_record, child_elem)->id;
 }
 
-/* remove and close the fd */
-void
-fd_list_remove (struct list *fl, int fd)
+struct proc_record *
+proc_current ()
 {
-  // invalid fd, cannot cloes stdin/stdout
-  if (fd < 2)
-    return;
-
-  for (struct list_elem *e = list_begin (fl); e != list_end (fl);
-       e = list_next (e))
-    {
-      struct fd_node *node = list_entry (e, struct fd_node, fd_elem);
-      if (fd == node->fd)
-        {
-          if (node->f)
-            file_close (node->f);
-          if (node->d)
-            dir_close (node->d);
-          list_remove (e);
-          free (node);
-          return;
-        }
-    }
+  return thread_current ()->proc;
 }
+
+/* SECTION-END */
+/* SECTION-END: children process management */
+/* SECTION-END */
@@ -2,6 +2,7 @@
 #define USERPROG_PROCESS_H
 
 #include "filesys/file.h"
+#include "lib/kernel/hash.h"
 #include "lib/kernel/list.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
@@ -9,8 +10,6 @@
 
 typedef int tid_t;
 
-#define MAX_CHS 64 // maximum child processes of a process
-
 enum proc_status
 {
   PROC_RUNNING,
@@ -18,23 +17,41 @@ enum proc_status
   PROC_ERROR_EXIT
 };
 
+#ifdef VM
+/* A file mapped into a process's memory by mmap(). */
+struct mmap_entry
+{
+  int id;                // mapping id returned to the process
+  void *addr;            // first mapped page
+  uint32_t pages;        // number of mapped pages
+  struct list_elem elem; // element in thread's mmap_list
+};
+#endif
+
 /* the process control block except the pagedir */
 struct proc_record
 {
-  tid_t id;                              // thread id of this process
-  int exit_code;                         // process status code
-  enum proc_status proc_status;          // the reason for process termination
-  struct semaphore sema_exit;            // up on exit, indicates proc exiting
-  bool orphan;                           // whether the parent process exists
-  struct proc_record *children[MAX_CHS]; // children process records
-  struct file *image;                    // the image of self.
+  tid_t id;                     // thread id of this process
+  int exit_code;                // process status code
+  enum proc_status proc_status; // the reason for process termination
+  struct semaphore sema_exit;   // up on exit, indicates proc exiting
+  bool exited;                  // whether the process has finished exiting
+  bool orphan;                  // whether the parent process exists
+  struct proc_record *parent;   // the parent's record, unless orphan
+  struct hash children;         // children process records, keyed by id
+  struct hash_elem child_elem;  // element in the parent's children
+  struct list done;             // exited children not waited for yet
+  struct list_elem done_elem;   // element in the parent's done
+  struct semaphore sema_child;  // up when a child exits
+  struct file *image;           // the image of self.
+  struct list_elem elem;        // element in the free records
 };
 
 /* find the process whose thread id equals to the given id and return the
  * process record */
 struct proc_record *proc_find (tid_t id);
 /* initialize a process record */
-void proc_init (struct proc_record *proc);
+bool proc_init (struct proc_record *proc);
 /* Find a child process with the given id.  */
 struct proc_record *proc_find_child (tid_t id);
 /* Find currently running process*/
@@ -44,30 +61,19 @@ void proc_add_child (struct proc_record *proc, struct proc_record *child);
 /* add a new child process id to the children list of current thread */
 void proc_remove_child (struct proc_record *child_proc);
 
-// The struct to record the fd and file mapping.
-struct fd_node
-{
-  int fd;         // file descriptor
-  struct file *f; // file
-  struct dir *d;  // directory
-  struct list_elem fd_elem;
-};
+/* Size of a process's console output buffer. */
+#define CONSOLE_BUF_SIZE 512
 
-/* clear the fd_list*/
-void fd_list_clear (struct list *fdlist);
-/* Insert new file and get proper fd */
-int fd_list_insertf (struct list *fl, struct file *f);
-/* Insert new directory and get proper fd */
-int fd_list_insertd (struct list *fl, struct dir *d);
-/* Get the file with specified fd */
-struct file *fd_list_getf (struct list *ls, int fd);
-/* Get the directory with specified fd */
-struct dir *fd_list_getd (struct list *ls, int fd);
-/* close and remove the fd, return the file */
-void fd_list_remove (struct list *ls, int fd);
+void process_console_write (const char *, size_t);
+void process_console_flush (void);
 
+void process_init (void);
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
+tid_t process_wait_any (int *status, int flags);
+#ifdef VM
+tid_t process_fork (void);
+#endif
 void process_exit (void);
 void process_activate (void);
 
@@ -6,10 +6,22 @@
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "userprog/aio.h"
+#include "userprog/process.h"
+#include "userprog/usercopy.h"
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include <uio.h>
+#include "threads/malloc.h"
+#ifdef VM
+#include "vm/sup_page.h"
+#include <round.h>
+#endif
 
 #define SYSCALL_FN(name) sys__##name
 
@@ -18,6 +30,8 @@ static void SYSCALL_FN (halt) (void);
 static void SYSCALL_FN (exit) (int status);
 static tid_t SYSCALL_FN (exec) (const char *cmd_line);
 static int SYSCALL_FN (wait) (tid_t pid);
+static tid_t SYSCALL_FN (wait_any) (int *status, int flags);
+static bool SYSCALL_FN (getrusage) (struct rusage *usage);
 static bool SYSCALL_FN (create) (const char *file, unsigned initial_size);
 static bool SYSCALL_FN (remove) (const char *file);
 static int SYSCALL_FN (open) (const char *file);
@@ -27,48 +41,35 @@ static int SYSCALL_FN (write) (int fd, const void *buffer, unsigned size);
 static void SYSCALL_FN (seek) (int fd, unsigned position);
 static unsigned SYSCALL_FN (tell) (int fd);
 static void SYSCALL_FN (close) (int fd);
-// static mapid_t SYSCALL_FN (mmap) (int fd, void *addr);
-// static void SYSCALL_FN (munmap) (mapid_t mapid);
+#ifdef VM
+static mapid_t SYSCALL_FN (mmap) (int fd, void *addr);
+static void SYSCALL_FN (munmap) (mapid_t mapid);
+static tid_t SYSCALL_FN (fork) (void);
+#endif
 /* directory syscall */
 static bool SYSCALL_FN (chdir) (const char *dir);
 static bool SYSCALL_FN (mkdir) (const char *dir);
 static bool SYSCALL_FN (readdir) (int fd, char *name);
 static bool SYSCALL_FN (isdir) (int fd);
 static int SYSCALL_FN (inumber) (int fd);
+static int SYSCALL_FN (create_batch) (int dirfd, const char *const *names,
+                                      unsigned cnt);
+static int SYSCALL_FN (pread) (int fd, void *buffer, unsigned size,
+                               unsigned position);
+static int SYSCALL_FN (pwrite) (int fd, const void *buffer, unsigned size,
+                                unsigned position);
+static int SYSCALL_FN (readv) (int fd, const struct iovec *iov, int iovcnt);
+static int SYSCALL_FN (writev) (int fd, const struct iovec *iov, int iovcnt);
+static int SYSCALL_FN (sendfile) (int out_fd, int in_fd, unsigned size);
+static bool SYSCALL_FN (aio_setup) (struct aio_ring *ring);
+static int SYSCALL_FN (aio_enter) (unsigned to_submit, unsigned min_complete);
 
-static void check_user_valid_string (const char *);
+static char *copy_in_string (const char *);
+static char *copy_in_long_string (const char *);
 static void check_user_valid_ptr (const void *);
+static void check_user_valid_buffer (const void *, unsigned size);
 struct file *get_current_open_file (int fd);
 
-/* Reads a byte at user virtual address UADDR.
-   UADDR must be below PHYS_BASE.
-   Returns the byte value if successful, -1 if a segfault
-   occurred. */
-static int32_t
-get_user (const uint8_t *uaddr)
-{
-  // accessing a kernel space memory, reject
-  if (!((void *)uaddr < PHYS_BASE))
-    return -1;
-
-  int result;
-  asm("movl $1f, %0; movzbl %1, %0; 1:" : "=&a"(result) : "m"(*uaddr));
-  return result;
-}
-
-/* Writes BYTE to user address UDST.
-   UDST must be below PHYS_BASE.
-   Returns true if successful, false if a segfault occurred. */
-static bool
-put_user (uint8_t *udst, uint8_t byte)
-{
-  int error_code;
-  asm("movl $1f, %0; movb %b2, %1; 1:"
-      : "=&a"(error_code), "=m"(*udst)
-      : "q"(byte));
-  return error_code != -1;
-}
-
 /* process exit on error */
 void
 err_exit ()
@@ -78,131 +79,189 @@ err_exit ()
   SYSCALL_FN (exit) (-1);
 }
 
-static uint32_t
-_syscall_arg (struct intr_frame *f, uint32_t idx)
-{
-  uint32_t arg = 0;
-  uint8_t *p_arg = (uint8_t *)&arg, *p_usr = f->esp + idx * 4;
-  // every argument is of 4 bytes
-  for (int i = 0; i < 4; i++, p_arg++, p_usr++)
-    {
-      int32_t tmp = get_user (p_usr);
-      // invalid argument address, terminate the process
-      if (tmp == -1)
-        err_exit ();
-      *p_arg = (uint8_t)tmp;
-    }
-  return arg;
-}
-
-// macros for extracting syscall argument
-#define syscall_arg(frame, idx, type) ((type)_syscall_arg (frame, idx))
+/* Forwarders from a system call's arguments, as copied from the
+   user stack, to its SYSCALL_FN (name).  Each returns the value
+   for eax, or 0 if the system call returns nothing. */
+typedef uint32_t syscall_fwd_func (const uint32_t args[]);
 
-#define ARG1(t1) syscall_arg (f, 1, t1)
-#define ARG2(t2) syscall_arg (f, 2, t2)
-#define ARG3(t3) syscall_arg (f, 3, t3)
+#define ARG(idx, type) ((type)args[idx])
 
 // macros for forwarding syscalls
 #define FWD0(fn)                                                              \
-  do                                                                          \
-    {                                                                         \
-      SYSCALL_FN (fn) ();                                                     \
-      return;                                                                 \
-    }                                                                         \
-  while (0)
+  static uint32_t fwd_##fn (const uint32_t args[] UNUSED)                     \
+  {                                                                           \
+    SYSCALL_FN (fn) ();                                                       \
+    return 0;                                                                 \
+  }
 #define FWD1(fn, t1)                                                          \
-  do                                                                          \
-    {                                                                         \
-      SYSCALL_FN (fn) (ARG1 (t1));                                            \
-      return;                                                                 \
-    }                                                                         \
-  while (0)
+  static uint32_t fwd_##fn (const uint32_t args[])                            \
+  {                                                                           \
+    SYSCALL_FN (fn) (ARG (0, t1));                                            \
+    return 0;                                                                 \
+  }
 #define FWD2(fn, t1, t2)                                                      \
-  do                                                                          \
-    {                                                                         \
-      SYSCALL_FN (fn) (ARG1 (t1), ARG2 (t2));                                 \
-      return;                                                                 \
-    }                                                                         \
-  while (0)
-#define FWD3(fn, t1, t2, t3)                                                  \
-  do                                                                          \
-    {                                                                         \
-      SYSCALL_FN (fn) (ARG1 (t1), ARG2 (t2), ARG3 (t3));                      \
-      return;                                                                 \
-    }                                                                         \
-  while (0)
+  static uint32_t fwd_##fn (const uint32_t args[])                            \
+  {                                                                           \
+    SYSCALL_FN (fn) (ARG (0, t1), ARG (1, t2));                               \
+    return 0;                                                                 \
+  }
 
 // macros for forwarding syscalls, with return value
 #define FWD0_RET(fn)                                                          \
-  do                                                                          \
-    {                                                                         \
-      f->eax = (uint32_t)(SYSCALL_FN (fn) ());                                \
-      return;                                                                 \
-    }                                                                         \
-  while (0)
+  static uint32_t fwd_##fn (const uint32_t args[] UNUSED)                     \
+  {                                                                           \
+    return (uint32_t)SYSCALL_FN (fn) ();                                      \
+  }
 #define FWD1_RET(fn, t1)                                                      \
-  do                                                                          \
-    {                                                                         \
-      f->eax = (uint32_t)(SYSCALL_FN (fn) (ARG1 (t1)));                       \
-      return;                                                                 \
-    }                                                                         \
-  while (0)
+  static uint32_t fwd_##fn (const uint32_t args[])                            \
+  {                                                                           \
+    return (uint32_t)SYSCALL_FN (fn) (ARG (0, t1));                           \
+  }
 #define FWD2_RET(fn, t1, t2)                                                  \
-  do                                                                          \
-    {                                                                         \
-      f->eax = (uint32_t)(SYSCALL_FN (fn) (ARG1 (t1), ARG2 (t2)));            \
-      return;                                                                 \
-    }                                                                         \
-  while (0)
+  static uint32_t fwd_##fn (const uint32_t args[])                            \
+  {                                                                           \
+    return (uint32_t)SYSCALL_FN (fn) (ARG (0, t1), ARG (1, t2));              \
+  }
 #define FWD3_RET(fn, t1, t2, t3)                                              \
-  do                                                                          \
-    {                                                                         \
-      f->eax = (uint32_t)(SYSCALL_FN (fn) (ARG1 (t1), ARG2 (t2), ARG3 (t3))); \
-      return;                                                                 \
-    }                                                                         \
-  while (0)
-
-// generate if else case
-#define FWD_CASE(nr, todo)                                                    \
-  do                                                                          \
-    if (id == nr)                                                             \
-      todo;                                                                   \
-  while (0)
+  static uint32_t fwd_##fn (const uint32_t args[])                            \
+  {                                                                           \
+    return (uint32_t)SYSCALL_FN (fn) (ARG (0, t1), ARG (1, t2),               \
+                                      ARG (2, t3));                           \
+  }
+#define FWD4_RET(fn, t1, t2, t3, t4)                                          \
+  static uint32_t fwd_##fn (const uint32_t args[])                            \
+  {                                                                           \
+    return (uint32_t)SYSCALL_FN (fn) (ARG (0, t1), ARG (1, t2),               \
+                                      ARG (2, t3), ARG (3, t4));              \
+  }
 
-static void
-syscall_handler (struct intr_frame *f)
+/* Projects 2 and later. */
+FWD0 (halt)
+FWD1 (exit, int)
+FWD1_RET (exec, const char *)
+FWD1_RET (wait, tid_t)
+FWD2_RET (create, const char *, unsigned)
+FWD1_RET (remove, const char *)
+FWD1_RET (open, const char *)
+FWD1_RET (filesize, int)
+FWD3_RET (read, int, void *, unsigned)
+FWD3_RET (write, int, const void *, unsigned)
+FWD2 (seek, int, unsigned)
+FWD1_RET (tell, int)
+FWD1 (close, int)
+FWD2_RET (wait_any, int *, int)
+FWD1_RET (getrusage, struct rusage *)
+/* Only in Project 3 */
+#ifdef VM
+FWD2_RET (mmap, int, void *)
+FWD1 (munmap, mapid_t)
+FWD0_RET (fork)
+#endif
+#ifdef FILESYS
+FWD1_RET (chdir, const char *)
+FWD1_RET (mkdir, const char *)
+FWD2_RET (readdir, int, char *)
+FWD1_RET (isdir, int)
+FWD1_RET (inumber, int)
+FWD3_RET (create_batch, int, const char *const *, unsigned)
+FWD4_RET (pread, int, void *, unsigned, unsigned)
+FWD4_RET (pwrite, int, const void *, unsigned, unsigned)
+FWD3_RET (readv, int, const struct iovec *, int)
+FWD3_RET (writev, int, const struct iovec *, int)
+FWD3_RET (sendfile, int, int, unsigned)
+FWD1_RET (aio_setup, struct aio_ring *)
+FWD2_RET (aio_enter, unsigned, unsigned)
+#endif
+
+/* Most arguments any system call takes. */
+#define SYSCALL_MAX_ARGS 4
+
+/* System call table entry. */
+struct syscall
 {
-  int id = syscall_arg (f, 0, int);
+  syscall_fwd_func *fwd; /* Forwarder, or null if not implemented. */
+  int argc;              /* Number of arguments. */
+  bool ret;              /* Returns a value in eax? */
+};
+
+#define SYSCALL(nr, fn, argc, ret) [nr] = { fwd_##fn, argc, ret }
 
+/* System calls, indexed by number. */
+static const struct syscall syscall_table[] = {
   /* Projects 2 and later. */
-  FWD_CASE (SYS_HALT, FWD0 (halt));
-  FWD_CASE (SYS_EXIT, FWD1 (exit, int));
-  FWD_CASE (SYS_EXEC, FWD1_RET (exec, const char *));
-  FWD_CASE (SYS_WAIT, FWD1_RET (wait, tid_t));
-  FWD_CASE (SYS_CREATE, FWD2_RET (create, const char *, unsigned));
-  FWD_CASE (SYS_REMOVE, FWD1_RET (remove, const char *));
-  FWD_CASE (SYS_OPEN, FWD1_RET (open, const char *));
-  FWD_CASE (SYS_FILESIZE, FWD1_RET (filesize, int));
-  FWD_CASE (SYS_READ, FWD3_RET (read, int, void *, unsigned));
-  FWD_CASE (SYS_WRITE, FWD3_RET (write, int, const void *, unsigned));
-  FWD_CASE (SYS_SEEK, FWD2 (seek, int, unsigned));
-  FWD_CASE (SYS_TELL, FWD1_RET (tell, int));
-  FWD_CASE (SYS_CLOSE, FWD1 (close, int));
+  SYSCALL (SYS_HALT, halt, 0, false),
+  SYSCALL (SYS_EXIT, exit, 1, false),
+  SYSCALL (SYS_EXEC, exec, 1, true),
+  SYSCALL (SYS_WAIT, wait, 1, true),
+  SYSCALL (SYS_CREATE, create, 2, true),
+  SYSCALL (SYS_REMOVE, remove, 1, true),
+  SYSCALL (SYS_OPEN, open, 1, true),
+  SYSCALL (SYS_FILESIZE, filesize, 1, true),
+  SYSCALL (SYS_READ, read, 3, true),
+  SYSCALL (SYS_WRITE, write, 3, true),
+  SYSCALL (SYS_SEEK, seek, 2, false),
+  SYSCALL (SYS_TELL, tell, 1, true),
+  SYSCALL (SYS_CLOSE, close, 1, false),
+  SYSCALL (SYS_WAIT_ANY, wait_any, 2, true),
+  SYSCALL (SYS_GETRUSAGE, getrusage, 1, true),
 /* Only in Project 3 */
 #ifdef VM
-  FWD_CASE (SYS_MMAP, FWD2_RET (mmap, int, void *));
-  FWD_CASE (SYS_MUNMAP, FWD1 (munmap, mapid_t));
+  SYSCALL (SYS_MMAP, mmap, 2, true),
+  SYSCALL (SYS_MUNMAP, munmap, 1, false),
 #endif
 #ifdef FILESYS
-  FWD_CASE (SYS_CHDIR, FWD1_RET (chdir, const char *));
-  FWD_CASE (SYS_MKDIR, FWD1_RET (mkdir, const char *));
-  FWD_CASE (SYS_READDIR, FWD2_RET (readdir, int, char *));
-  FWD_CASE (SYS_ISDIR, FWD1_RET (isdir, int));
-  FWD_CASE (SYS_INUMBER, FWD1_RET (inumber, int));
+  SYSCALL (SYS_CHDIR, chdir, 1, true),
+  SYSCALL (SYS_MKDIR, mkdir, 1, true),
+  SYSCALL (SYS_READDIR, readdir, 2, true),
+  SYSCALL (SYS_ISDIR, isdir, 1, true),
+  SYSCALL (SYS_INUMBER, inumber, 1, true),
+  SYSCALL (SYS_CREATE_BATCH, create_batch, 3, true),
+  SYSCALL (SYS_PREAD, pread, 4, true),
+  SYSCALL (SYS_PWRITE, pwrite, 4, true),
+  SYSCALL (SYS_READV, readv, 3, true),
+  SYSCALL (SYS_WRITEV, writev, 3, true),
+  SYSCALL (SYS_SENDFILE, sendfile, 3, true),
+  SYSCALL (SYS_AIO_SETUP, aio_setup, 1, true),
+  SYSCALL (SYS_AIO_ENTER, aio_enter, 2, true),
+#endif
+#ifdef VM
+  SYSCALL (SYS_FORK, fork, 0, true),
+#endif
+};
+
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+static void
+syscall_handler (struct intr_frame *f)
+{
+  uint32_t nr, args[SYSCALL_MAX_ARGS];
+  const uint32_t *usp = f->esp;
+#ifdef VM
+  // kernel page faults on the user stack grow it from here
+  thread_current ()->user_esp = f->esp;
 #endif
 
+  // the number, then all arguments in one copy
+  if (!copy_from_user (&nr, usp, sizeof nr))
+    err_exit ();
+  const struct syscall *sc = nr < SYSCALL_CNT ? &syscall_table[nr] : NULL;
   // invalid system call
-  err_exit ();
+  if (sc == NULL || sc->fwd == NULL)
+    err_exit ();
+  ASSERT (sc->argc <= SYSCALL_MAX_ARGS);
+  if (!copy_from_user (args, usp + 1, sc->argc * sizeof *args))
+    err_exit ();
+  if (nr < RUSAGE_SYSCALLS)
+    thread_current ()->rusage.syscalls[nr]++;
+
+  // console writes collect in the process's buffer until it does
+  // anything else, so output stays ordered with other processes'
+  if (nr != SYS_WRITE)
+    process_console_flush ();
+
+  uint32_t result = sc->fwd (args);
+  if (sc->ret)
+    f->eax = result;
 }
 void
 syscall_init (void)
@@ -233,111 +292,197 @@ SYSCALL_FN (exit) (int status)
 static tid_t
 SYSCALL_FN (exec) (const char *cmd_line)
 {
-  check_user_valid_string (cmd_line);
-  return process_execute (cmd_line);
+  char *kcmd_line = copy_in_long_string (cmd_line);
+  if (kcmd_line == NULL)
+    return TID_ERROR;
+  tid_t tid = process_execute (kcmd_line);
+  free (kcmd_line);
+  return tid;
 }
 static int
 SYSCALL_FN (wait) (tid_t pid)
 {
   return process_wait (pid);
 }
+static tid_t
+SYSCALL_FN (wait_any) (int *status, int flags)
+{
+  int code;
+  tid_t tid = process_wait_any (&code, flags);
+  if (tid > 0 && status != NULL && !copy_to_user (status, &code, sizeof code))
+    err_exit ();
+  return tid;
+}
+static bool
+SYSCALL_FN (getrusage) (struct rusage *usage)
+{
+  if (!copy_to_user (usage, &thread_current ()->rusage, sizeof *usage))
+    err_exit ();
+  return true;
+}
 static bool
 SYSCALL_FN (create) (const char *file, unsigned initial_size)
 {
-  check_user_valid_string (file);
-  
-  // create empty name or create directory
-  size_t len = strlen (file);
-  if (len == 0 || file[len - 1] == '/')
+  char *kfile = copy_in_string (file);
+  if (kfile == NULL)
     return false;
 
-  bool result = filesys_create (file, initial_size, false);
+  // create empty name or create directory
+  size_t len = strlen (kfile);
+  bool result = len != 0 && kfile[len - 1] != '/'
+                && filesys_create (kfile, initial_size, false);
+  palloc_free_page (kfile);
   return result;
 }
 static bool
 SYSCALL_FN (remove) (const char *file)
 {
-  check_user_valid_string (file);
-  bool result = filesys_remove (file);
+  char *kfile = copy_in_string (file);
+  if (kfile == NULL)
+    return false;
+  bool result = filesys_remove (kfile);
+  palloc_free_page (kfile);
   return result;
 }
 static int
 SYSCALL_FN (open) (const char *file)
 {
   int fd = -1;
-  // Check if pointer is NULL
-  check_user_valid_string (file);
+  char *kfile = copy_in_string (file);
   // reject empty path
-  if (strlen (file) == 0)
-    return -1;
-
-  if (filesys_isdir (file))
+  if (kfile == NULL || strlen (kfile) == 0)
+    ;
+  else if (filesys_isdir (kfile))
     // open dir
     {
-      struct dir *dp = dir_open_path (file);
-      if (dp != NULL)
-        fd = fd_list_insertd (&thread_current ()->fd_list, dp);
+      struct dir *dp = dir_open_path (kfile);
+      if (dp != NULL
+          && (fd = fd_table_insertd (&thread_current ()->fd_table, dp)) < 0)
+        dir_close (dp);
     }
   else
     // open file
     {
-      struct file *fp = filesys_open (file);
-      if (fp != NULL)
-        fd = fd_list_insertf (&thread_current ()->fd_list, fp);
+      struct file *fp = filesys_open (kfile);
+      if (fp != NULL
+          && (fd = fd_table_insertf (&thread_current ()->fd_table, fp)) < 0)
+        file_close (fp);
     }
+  palloc_free_page (kfile);
   return fd;
 }
 static int
 SYSCALL_FN (filesize) (int fd)
 {
-  struct file *f = fd_list_getf (&thread_current ()->fd_list, fd);
+  struct file *f = fd_table_getf (&thread_current ()->fd_table, fd);
   if (f == NULL)
     err_exit ();
   int result = file_length (f);
   return result;
 }
+/* Reads SIZE bytes into user BUFFER, which must be valid, from
+   the console if FP is null, else from FP at *POS (advancing it)
+   or, if POS is null, at FP's position.  Goes through a kernel
+   buffer a page at a time.  A console read waits for the first
+   key only, and returns the keys typed so far, up to the end of
+   a line.  Returns the number of bytes read, or -1 if out of
+   memory. */
 static int
-SYSCALL_FN (read) (int fd, void *buffer, unsigned size)
+read_into_user (struct file *fp, void *buffer, unsigned size, off_t *pos)
 {
-  // Check pointer, head and tail
-  for (uint32_t i = 0; i < size; i++)
-    check_user_valid_ptr (buffer + i);
-  // Handle input from console.
-  if (fd == 0)
+  uint8_t *bounce = palloc_get_page (0);
+  if (bounce == NULL)
+    return -1;
+  unsigned done = 0;
+  while (done < size)
     {
-      uint8_t *buf = (uint8_t *)buffer;
-      for (uint32_t i = 0; i < size; ++i)
+      unsigned chunk = size - done < PGSIZE ? size - done : PGSIZE;
+      int n = chunk;
+      // Handle input from console.
+      if (fp == NULL)
+        n = input_read (bounce, chunk);
+      else if (pos != NULL)
         {
-          // error exit on invalid memory write
-          if (!put_user (buf + i, input_getc ()))
-            err_exit ();
+          n = file_read_at (fp, bounce, chunk, *pos);
+          *pos += n;
+        }
+      else
+        n = file_read (fp, bounce, chunk);
+      if (n > 0 && !copy_to_user (buffer + done, bounce, n))
+        {
+          palloc_free_page (bounce);
+          err_exit ();
         }
-      return size;
+      done += n;
+      if (fp == NULL || (unsigned)n < chunk)
+        break;
     }
-  // Read file
-  struct file *fp = get_current_open_file (fd);
-  int result = file_read (fp, buffer, size);
-  return result;
+  palloc_free_page (bounce);
+  return done;
 }
 
+/* Writes SIZE bytes from user BUFFER, which must be valid, to the
+   console if FP is null, else to FP at *POS (advancing it) or,
+   if POS is null, at FP's position.  Goes through a kernel
+   buffer a page at a time.  Returns the number of bytes written,
+   or -1 if out of memory or the disk is full before any byte is
+   written. */
 static int
-SYSCALL_FN (write) (int fd, const void *buffer, unsigned size)
+write_from_user (struct file *fp, const void *buffer, unsigned size,
+                 off_t *pos)
 {
-  // Check pointer, head and tail
-  for (uint32_t i = 0; i < size; i++)
-    check_user_valid_ptr (buffer + i);
-
-  // Handle write to console.
-  if (fd == 1)
+  uint8_t *bounce = palloc_get_page (0);
+  if (bounce == NULL)
+    return -1;
+  unsigned done = 0;
+  bool full = false;
+  while (done < size)
     {
-      putbuf (buffer, size);
-      return size;
+      unsigned chunk = size - done < PGSIZE ? size - done : PGSIZE;
+      int n = chunk;
+      if (!copy_from_user (bounce, buffer + done, chunk))
+        {
+          palloc_free_page (bounce);
+          err_exit ();
+        }
+      // Handle write to console.
+      if (fp == NULL)
+        process_console_write ((char *)bounce, chunk);
+      else if (pos != NULL)
+        {
+          n = file_write_at (fp, bounce, chunk, *pos);
+          if (n > 0)
+            *pos += n;
+        }
+      else
+        n = file_write (fp, bounce, chunk);
+      if (n < 0)
+        {
+          full = true;
+          break;
+        }
+      done += n;
+      if ((unsigned)n < chunk)
+        break;
     }
-  // Read file
-  struct file *fp = get_current_open_file (fd);
-  // Write file.
-  int result = file_write (fp, buffer, size);
-  return result;
+  palloc_free_page (bounce);
+  return done > 0 || !full ? (int)done : -1;
+}
+
+static int
+SYSCALL_FN (read) (int fd, void *buffer, unsigned size)
+{
+  check_user_valid_buffer (buffer, size);
+  struct file *fp = fd == 0 ? NULL : get_current_open_file (fd);
+  return read_into_user (fp, buffer, size, NULL);
+}
+
+static int
+SYSCALL_FN (write) (int fd, const void *buffer, unsigned size)
+{
+  check_user_valid_buffer (buffer, size);
+  struct file *fp = fd == 1 ? NULL : get_current_open_file (fd);
+  return write_from_user (fp, buffer, size, NULL);
 }
 static void
 SYSCALL_FN (seek) (int fd, unsigned position)
@@ -358,37 +503,188 @@ SYSCALL_FN (tell) (int fd)
 static void
 SYSCALL_FN (close) (int fd)
 {
-  fd_list_remove (&thread_current ()->fd_list, fd);
+  fd_table_remove (&thread_current ()->fd_table, fd);
+}
+
+#ifdef VM
+/* Maps the file open as FD into memory at ADDR.  Pages are read
+   from the file when first touched, and written back if dirty
+   when unmapped.  Returns the mapping's id, or -1 if FD is not a
+   file, the file is empty, or ADDR is null, unaligned, or
+   overlaps a page the process already has. */
+static mapid_t
+SYSCALL_FN (mmap) (int fd, void *addr)
+{
+  struct thread *cur = thread_current ();
+  struct vm_sup_page_table *table = cur->supplemental_table;
+  struct file *f = fd_table_getf (&cur->fd_table, fd);
+  if (f == NULL || addr == NULL || pg_ofs (addr) != 0)
+    return -1;
+  off_t length = file_length (f);
+  uint32_t pages = DIV_ROUND_UP (length, PGSIZE);
+  if (length == 0)
+    return -1;
+  for (uint32_t i = 0; i < pages; i++)
+    {
+      void *upage = (uint8_t *)addr + i * PGSIZE;
+      if (!is_user_vaddr (upage) || vm_sup_page_find_entry (table, upage))
+        return -1;
+    }
+
+  // the mapping outlives FD
+  struct mmap_entry *m = malloc (sizeof *m);
+  struct file *mf = file_reopen (f);
+  if (m == NULL || mf == NULL)
+    {
+      free (m);
+      file_close (mf);
+      return -1;
+    }
+  for (uint32_t i = 0; i < pages; i++)
+    {
+      off_t ofs = i * PGSIZE;
+      uint32_t bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+      if (!vm_sup_page_map (table, (uint8_t *)addr + ofs, mf, ofs, bytes))
+        {
+          // unmapping the pages mapped so far closes MF
+          if (i > 0)
+            vm_sup_page_unmap (table, addr, i);
+          else
+            file_close (mf);
+          free (m);
+          return -1;
+        }
+    }
+  m->id = cur->next_mapid++;
+  m->addr = addr;
+  m->pages = pages;
+  list_push_back (&cur->mmap_list, &m->elem);
+  return m->id;
 }
 
-/* Check whether the string is valid in user space */
+/* Unmaps mapping MAPID of the current process, writing its dirty
+   pages back to the file.  Does nothing if there is no such
+   mapping. */
 static void
-check_user_valid_string (const char *str)
+SYSCALL_FN (munmap) (mapid_t mapid)
 {
-  // Null pointer
-  if (str == NULL)
-    err_exit ();
-  int i = 0;
-  // any char of the string not in the user space.
-  do
-    if (get_user ((void *)str + i) == -1)
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->mmap_list); e != list_end (&cur->mmap_list);
+       e = list_next (e))
+    {
+      struct mmap_entry *m = list_entry (e, struct mmap_entry, elem);
+      if (m->id == mapid)
+        {
+#ifdef FILESYS
+          // requests in flight may use the mapping
+          aio_wait ();
+#endif
+          list_remove (&m->elem);
+          vm_sup_page_unmap (cur->supplemental_table, m->addr, m->pages);
+          free (m);
+          return;
+        }
+    }
+}
+
+static tid_t
+SYSCALL_FN (fork) (void)
+{
+  return process_fork ();
+}
+#endif
+
+/* Copies the string at user address USTR into a new page, which
+   the caller must free.  Kills the process if USTR is a bad
+   pointer.  Returns a null pointer if the string does not fit in
+   a page or no page is free. */
+static char *
+copy_in_string (const char *ustr)
+{
+  char *kstr = palloc_get_page (0);
+  if (kstr == NULL)
+    return NULL;
+  int len = strncpy_from_user (kstr, ustr, PGSIZE);
+  if (len < 0)
+    {
+      palloc_free_page (kstr);
       err_exit ();
-  while (str[i++] != 0);
+    }
+  if (len == PGSIZE)
+    {
+      palloc_free_page (kstr);
+      return NULL;
+    }
+  return kstr;
+}
+
+/* Like copy_in_string(), but for strings of any length: the
+   buffer starts at a page and doubles until the string fits.  The
+   caller must free() the result.  Returns a null pointer if
+   memory runs out. */
+static char *
+copy_in_long_string (const char *ustr)
+{
+  size_t size = PGSIZE, len = 0;
+  char *kstr = NULL;
+  for (;;)
+    {
+      char *grown = realloc (kstr, size);
+      if (grown == NULL)
+        {
+          free (kstr);
+          return NULL;
+        }
+      kstr = grown;
+      int n = strncpy_from_user (kstr + len, ustr + len, size - len);
+      if (n < 0)
+        {
+          free (kstr);
+          err_exit ();
+        }
+      if ((size_t)n < size - len)
+        return kstr;
+      len = size;
+      size *= 2;
+    }
 }
 
 /* Check whethter the give pointer is valid in user space.  */
 static void
 check_user_valid_ptr (const void *ptr)
 {
-  if (ptr == NULL || get_user (ptr) == -1)
+  uint8_t byte;
+  if (ptr == NULL || !copy_from_user (&byte, ptr, 1))
     err_exit ();
 }
+/* Check whether the SIZE bytes at BUFFER are valid in user
+   space.  Pages are mapped whole, so one byte per page is probed:
+   the last byte first, so that a buffer reaching into kernel
+   space is rejected before walking its pages. */
+static void
+check_user_valid_buffer (const void *buffer, unsigned size)
+{
+  if (size == 0)
+    return;
+  const uint8_t *first = buffer, *last = first + (size - 1);
+  // wrapped around the address space
+  if (last < first)
+    err_exit ();
+  check_user_valid_ptr (last);
+  check_user_valid_ptr (first);
+  for (const uint8_t *p = (uint8_t *)pg_round_down (first) + PGSIZE; p < last;
+       p += PGSIZE)
+    check_user_valid_ptr (p);
+}
+
 /* Get the file of the current process with fd.
   exit(-1) if the file doesn't exist */
 struct file *
 get_current_open_file (int fd)
 {
-  struct file *fp = fd_list_getf (&thread_current ()->fd_list, fd);
+  struct file *fp = fd_table_getf (&thread_current ()->fd_table, fd);
   if (fp == NULL)
     err_exit ();
   return fp;
@@ -400,33 +696,46 @@ Returns true if successful, false on failure. */
 static bool
 SYSCALL_FN (chdir) (const char *dir)
 {
-  bool result = filesys_chdir (dir);
+  char *kdir = copy_in_string (dir);
+  if (kdir == NULL)
+    return false;
+  bool result = filesys_chdir (kdir);
+  palloc_free_page (kdir);
   return result;
 }
 static bool
 SYSCALL_FN (mkdir) (const char *dir)
 {
-  bool result = filesys_mkdir (dir);
+  char *kdir = copy_in_string (dir);
+  if (kdir == NULL)
+    return false;
+  bool result = filesys_mkdir (kdir);
+  palloc_free_page (kdir);
   return result;
 }
 static bool
 SYSCALL_FN (readdir) (int fd, char *name)
 {
-  struct dir *dir = fd_list_getd (&thread_current ()->fd_list, fd);
+  struct dir *dir = fd_table_getd (&thread_current ()->fd_table, fd);
+  char kname[NAME_MAX + 1];
   if (!dir)
     err_exit ();
-  return dir_read (dir, name);
+  if (!dir_read (dir, kname))
+    return false;
+  if (!copy_to_user (name, kname, strlen (kname) + 1))
+    err_exit ();
+  return true;
 }
 static bool
 SYSCALL_FN (isdir) (int fd)
 {
-  return fd_list_getd (&thread_current ()->fd_list, fd) != NULL;
+  return fd_table_getd (&thread_current ()->fd_table, fd) != NULL;
 }
 static int
 SYSCALL_FN (inumber) (int fd)
 {
-  struct file *f = fd_list_getf (&thread_current ()->fd_list, fd);
-  struct dir *d = fd_list_getd (&thread_current ()->fd_list, fd);
+  struct file *f = fd_table_getf (&thread_current ()->fd_table, fd);
+  struct dir *d = fd_table_getd (&thread_current ()->fd_table, fd);
   if (f)
     return inode_get_inumber (file_get_inode (f));
   if (d)
@@ -436,3 +745,215 @@ SYSCALL_FN (inumber) (int fd)
   err_exit ();
   return -1;
 }
+
+/* Number of names create_batch() copies in at a time. */
+#define CREATE_BATCH_COPY 32
+
+/* Creates CNT empty files named NAMES[] in the directory open as
+   DIRFD, many files per file system lock hold.
+   Returns the number of files created, which stops short of CNT
+   at the first name that cannot be created. */
+static int
+SYSCALL_FN (create_batch) (int dirfd, const char *const *names, unsigned cnt)
+{
+  struct dir *dir = fd_table_getd (&thread_current ()->fd_table, dirfd);
+  const char *unames[CREATE_BATCH_COPY];
+  char knames[CREATE_BATCH_COPY][NAME_MAX + 2];
+  const char *kname_ptrs[CREATE_BATCH_COPY];
+  unsigned created = 0;
+
+  if (!dir)
+    err_exit ();
+  while (created < cnt)
+    {
+      size_t n = cnt - created < CREATE_BATCH_COPY ? cnt - created
+                                                   : CREATE_BATCH_COPY;
+      size_t valid;
+      if (!copy_from_user (unames, names + created, n * sizeof *unames))
+        err_exit ();
+      // a name too long to create ends the batch
+      for (valid = 0; valid < n; valid++)
+        {
+          int len = strncpy_from_user (knames[valid], unames[valid],
+                                       sizeof knames[valid]);
+          if (len < 0)
+            err_exit ();
+          if ((size_t)len > NAME_MAX)
+            break;
+          kname_ptrs[valid] = knames[valid];
+        }
+
+      size_t done = filesys_create_batch (dir, kname_ptrs, valid);
+      created += done;
+      if (done < n)
+        break;
+    }
+  return created;
+}
+
+/* Reads SIZE bytes from the file open as FD, starting at byte
+   POSITION, into BUFFER, without moving the file position.
+   Returns the number of bytes read, or -1 if FD is the console. */
+static int
+SYSCALL_FN (pread) (int fd, void *buffer, unsigned size, unsigned position)
+{
+  check_user_valid_buffer (buffer, size);
+  if (fd == 0 || fd == 1)
+    return -1;
+  struct file *fp = get_current_open_file (fd);
+  off_t pos = position;
+  return read_into_user (fp, buffer, size, &pos);
+}
+
+/* Writes SIZE bytes from BUFFER to the file open as FD, starting
+   at byte POSITION, without moving the file position.
+   Returns the number of bytes written, or -1 if FD is the
+   console. */
+static int
+SYSCALL_FN (pwrite) (int fd, const void *buffer, unsigned size,
+                     unsigned position)
+{
+  check_user_valid_buffer (buffer, size);
+  if (fd == 0 || fd == 1)
+    return -1;
+  struct file *fp = get_current_open_file (fd);
+  off_t pos = position;
+  return write_from_user (fp, buffer, size, &pos);
+}
+
+/* Number of iovecs readv() and writev() copy in at a time. */
+#define IOV_COPY 16
+
+/* Reads (if WRITE is false) or writes the IOVCNT buffers IOV[]
+   in order, for readv() and writev().  Stops at the first short
+   transfer.  Returns the total number of bytes transferred, or
+   -1 if IOVCNT is out of range or the lengths add up to more
+   than INT_MAX. */
+static int
+transfer_iov (int fd, const struct iovec *iov, int iovcnt, bool write)
+{
+  struct iovec kiov[IOV_COPY];
+  int total = 0;
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return -1;
+  // check the sum up front, so that nothing is transferred if it
+  // cannot be returned
+  size_t sum = 0;
+  for (int i = 0; i < iovcnt; i += IOV_COPY)
+    {
+      int n = iovcnt - i < IOV_COPY ? iovcnt - i : IOV_COPY;
+      if (!copy_from_user (kiov, iov + i, n * sizeof *kiov))
+        err_exit ();
+      for (int j = 0; j < n; j++)
+        {
+          if (kiov[j].iov_len > INT_MAX - sum)
+            return -1;
+          sum += kiov[j].iov_len;
+        }
+    }
+  struct file *fp = fd == (write ? 1 : 0) ? NULL : get_current_open_file (fd);
+  for (int i = 0; i < iovcnt; i += IOV_COPY)
+    {
+      int n = iovcnt - i < IOV_COPY ? iovcnt - i : IOV_COPY;
+      if (!copy_from_user (kiov, iov + i, n * sizeof *kiov))
+        err_exit ();
+      for (int j = 0; j < n; j++)
+        {
+          unsigned len = kiov[j].iov_len;
+          int done;
+          // the process may have changed IOV since the check
+          if (len > (unsigned)(INT_MAX - total))
+            return total > 0 ? total : -1;
+          check_user_valid_buffer (kiov[j].iov_base, len);
+          done = write ? write_from_user (fp, kiov[j].iov_base, len, NULL)
+                       : read_into_user (fp, kiov[j].iov_base, len, NULL);
+          if (done < 0)
+            return total > 0 ? total : -1;
+          total += done;
+          if ((unsigned)done < len)
+            return total;
+        }
+    }
+  return total;
+}
+
+/* Reads from the file open as FD into the IOVCNT buffers IOV[],
+   filling each before the next.  Returns the number of bytes
+   read. */
+static int
+SYSCALL_FN (readv) (int fd, const struct iovec *iov, int iovcnt)
+{
+  return transfer_iov (fd, iov, iovcnt, false);
+}
+
+/* Writes the IOVCNT buffers IOV[] in order to the file open as
+   FD.  Returns the number of bytes written. */
+static int
+SYSCALL_FN (writev) (int fd, const struct iovec *iov, int iovcnt)
+{
+  return transfer_iov (fd, iov, iovcnt, true);
+}
+
+/* Copies up to SIZE bytes from the file open as IN_FD, starting
+   at its position, to the file or console open as OUT_FD, without
+   passing the data through user memory.  Advances both file
+   positions by the number of bytes copied, and returns it, or -1
+   if IN_FD or OUT_FD is the wrong console fd, out of memory, or
+   the disk is full before any byte is copied. */
+static int
+SYSCALL_FN (sendfile) (int out_fd, int in_fd, unsigned size)
+{
+  if (in_fd == 0 || in_fd == 1 || out_fd == 0)
+    return -1;
+  struct file *in = get_current_open_file (in_fd);
+  struct file *out = out_fd == 1 ? NULL : get_current_open_file (out_fd);
+
+  uint8_t *buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return -1;
+  unsigned done = 0;
+  bool full = false;
+  while (done < size)
+    {
+      unsigned chunk = size - done < PGSIZE ? size - done : PGSIZE;
+      int n = file_read (in, buffer, chunk);
+      if (n <= 0)
+        break;
+      int written = n;
+      if (out == NULL)
+        process_console_write ((char *)buffer, n);
+      else
+        written = file_write (out, buffer, n);
+      if (written < n)
+        {
+          // leave the bytes that were not written unread
+          full = written < 0;
+          if (full)
+            written = 0;
+          file_seek (in, file_tell (in) - (n - written));
+          done += written;
+          break;
+        }
+      done += written;
+      if ((unsigned)n < chunk)
+        break;
+    }
+  palloc_free_page (buffer);
+  return done > 0 || !full ? (int)done : -1;
+}
+
+/* Registers RING for asynchronous I/O, see userprog/aio.c. */
+static bool
+SYSCALL_FN (aio_setup) (struct aio_ring *ring)
+{
+  return aio_setup (ring);
+}
+
+/* Submits asynchronous I/O and waits for completions, see
+   userprog/aio.c. */
+static int
+SYSCALL_FN (aio_enter) (unsigned to_submit, unsigned min_complete)
+{
+  return aio_enter (to_submit, min_complete);
+}
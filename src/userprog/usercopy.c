@@ -0,0 +1,77 @@
+#include "userprog/usercopy.h"
+#include "threads/vaddr.h"
+#include <stdint.h>
+#include <string.h>
+
+/* Returns true if the SIZE bytes at user address UADDR are all
+   below PHYS_BASE. */
+static bool
+is_user_range (const void *uaddr, size_t size)
+{
+  return is_user_vaddr (uaddr)
+         && size <= (uintptr_t)PHYS_BASE - (uintptr_t)uaddr;
+}
+
+/* Copies SIZE bytes from SRC to DST, a word at a time and then
+   the remaining bytes.  One of SRC and DST is in user memory.
+   Returns false if a page fault interrupted the copy. */
+static bool
+copy_user (void *dst, const void *src, size_t size)
+{
+  size_t words = size / sizeof (uint32_t);
+  size_t bytes = size % sizeof (uint32_t);
+  int result;
+
+  /* A fault in either "rep movs" lands on label 1 with eax set
+     to -1; otherwise eax holds the label's address. */
+  asm volatile("movl $1f, %%eax; rep movsl; movl %4, %%ecx; rep movsb; 1:"
+               : "=&a"(result), "+S"(src), "+D"(dst), "+c"(words)
+               : "rm"(bytes)
+               : "memory");
+  return result != -1;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address DST.
+   Returns true if successful, false if any byte of the source
+   is not readable user memory. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  return is_user_range (usrc, size) && copy_user (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address UDST.
+   Returns true if successful, false if any byte of the
+   destination is not writable user memory. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  return is_user_range (udst, size) && copy_user (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes, a page at a time.
+   Returns the length of the string, or SIZE if it did not fit
+   (in which case DST is not null-terminated), or -1 if the
+   string runs into memory that is not readable user memory. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t copied = 0;
+  while (copied < size)
+    {
+      /* A page is readable as a whole or not at all, so the copy
+         may run past the null terminator up to the page end. */
+      size_t chunk = PGSIZE - pg_ofs (usrc + copied);
+      if (chunk > size - copied)
+        chunk = size - copied;
+      if (!copy_from_user (dst + copied, usrc + copied, chunk))
+        return -1;
+
+      char *end = memchr (dst + copied, '\0', chunk);
+      if (end != NULL)
+        return end - dst;
+      copied += chunk;
+    }
+  return size;
+}
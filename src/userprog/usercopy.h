@@ -0,0 +1,18 @@
+#ifndef USERPROG_USERCOPY_H
+#define USERPROG_USERCOPY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Copying between kernel and user memory.
+
+   These may be called with any user address.  A copy that
+   touches an unmapped or read-only page, or kernel memory, fails
+   instead of faulting: page_fault() resumes it at its fix-up
+   label with eax set to -1. */
+
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+
+#endif /* userprog/usercopy.h */
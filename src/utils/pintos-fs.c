@@ -0,0 +1,118 @@
+#include "pintos-fs.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Partition type of a Pintos file system, see utils/Pintos.pm. */
+#define PART_TYPE_FILESYS 0x21
+
+/* Opens image NAME with fopen() MODE.  If NAME is a partitioned
+   disk, as made by pintos-mkdisk, selects its file system
+   partition; otherwise the whole file is the file system, as
+   taken by pintos-mkdisk --filesys=FILE.
+   Returns false and prints a message on failure. */
+bool
+fs_image_open (struct fs_image *img, const char *name, const char *mode)
+{
+  uint8_t mbr[SECTOR_SIZE];
+  long size;
+
+  img->name = name;
+  img->file = fopen (name, mode);
+  if (img->file == NULL)
+    {
+      fprintf (stderr, "%s: open: %s\n", name, strerror (errno));
+      return false;
+    }
+  if (fseek (img->file, 0, SEEK_END) != 0 || (size = ftell (img->file)) < 0)
+    {
+      fprintf (stderr, "%s: seek: %s\n", name, strerror (errno));
+      fclose (img->file);
+      return false;
+    }
+
+  img->offset = 0;
+  img->sectors = size / SECTOR_SIZE;
+  rewind (img->file);
+  if (size >= SECTOR_SIZE && fread (mbr, SECTOR_SIZE, 1, img->file) == 1
+      && mbr[510] == 0x55 && mbr[511] == 0xaa)
+    {
+      int i;
+      for (i = 0; i < 4; i++)
+        {
+          const uint8_t *p = mbr + 446 + 16 * i;
+          if (p[4] == PART_TYPE_FILESYS)
+            {
+              img->offset = (long)(p[8] | p[9] << 8 | p[10] << 16
+                                   | (uint32_t)p[11] << 24)
+                            * SECTOR_SIZE;
+              img->sectors = p[12] | p[13] << 8 | p[14] << 16
+                             | (uint32_t)p[15] << 24;
+              break;
+            }
+        }
+      if (i == 4)
+        {
+          fprintf (stderr, "%s: partitioned disk has no file system\n",
+                   name);
+          fclose (img->file);
+          return false;
+        }
+    }
+
+  if (img->sectors == 0)
+    {
+      fprintf (stderr, "%s: file system is empty\n", name);
+      fclose (img->file);
+      return false;
+    }
+  return true;
+}
+
+void
+fs_image_close (struct fs_image *img)
+{
+  if (fclose (img->file) != 0)
+    fprintf (stderr, "%s: close: %s\n", img->name, strerror (errno));
+}
+
+static void
+seek_sector (struct fs_image *img, uint32_t sector)
+{
+  if (sector >= img->sectors)
+    {
+      fprintf (stderr, "%s: sector %u beyond end of file system\n",
+               img->name, sector);
+      exit (2);
+    }
+  if (fseek (img->file, img->offset + (long)sector * SECTOR_SIZE, SEEK_SET))
+    {
+      fprintf (stderr, "%s: seek: %s\n", img->name, strerror (errno));
+      exit (2);
+    }
+}
+
+/* Reads SECTOR of the file system into BUF.  Exits on error. */
+void
+fs_image_read (struct fs_image *img, uint32_t sector, void *buf)
+{
+  seek_sector (img, sector);
+  if (fread (buf, SECTOR_SIZE, 1, img->file) != 1)
+    {
+      fprintf (stderr, "%s: short read of sector %u\n", img->name, sector);
+      exit (2);
+    }
+}
+
+/* Writes BUF to SECTOR of the file system.  Exits on error. */
+void
+fs_image_write (struct fs_image *img, uint32_t sector, const void *buf)
+{
+  seek_sector (img, sector);
+  if (fwrite (buf, SECTOR_SIZE, 1, img->file) != 1)
+    {
+      fprintf (stderr, "%s: write of sector %u: %s\n", img->name, sector,
+               strerror (errno));
+      exit (2);
+    }
+}
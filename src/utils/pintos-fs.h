@@ -0,0 +1,127 @@
+#ifndef UTILS_PINTOS_FS_H
+#define UTILS_PINTOS_FS_H
+
+/* Host-side view of the Pintos file system format, for tools that
+   work on disk images without booting Pintos.
+   Everything here must match the kernel: struct inode_disk and
+   struct indirect_block in filesys/inode.c, struct dir_entry in
+   filesys/directory.c, the journal header in filesys/journal.c
+   and the sector numbers in filesys/filesys.h and
+   filesys/journal.h, and struct superblock in
+   filesys/free-map.c. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define SECTOR_SIZE 512
+
+/* Fixed sectors. */
+#define FREE_MAP_SECTOR 0 /* Free map file inode. */
+#define ROOT_DIR_SECTOR 1 /* Root directory inode. */
+#define SUPER_SECTOR 2    /* Superblock. */
+#define JOURNAL_SECTOR 3  /* Journal header. */
+#define JOURNAL_SLOTS 64  /* Journal records after the header. */
+#define JOURNAL_SECTORS (1 + JOURNAL_SLOTS)
+
+/* Inodes address at most 8 MB through 16-bit sector numbers. */
+typedef uint16_t fs_sec_t;
+#define FS_SECTORS (8 * 1024 * 1024 / SECTOR_SIZE)
+#define PTR_PER_SEC (SECTOR_SIZE / sizeof (fs_sec_t))
+#define INDIRECT_COUNT (FS_SECTORS / PTR_PER_SEC)
+#define ERR_SECTOR ((fs_sec_t)-1)
+
+#define INODE_MAGIC 0x494e4f44
+#define JOURNAL_MAGIC 0x4a524e4c
+#define SUPER_MAGIC 0x53555052
+
+/* The superblock summarizes the free map in at most SUPER_GROUPS
+   groups of GROUP_SIZE sectors each. */
+#define SUPER_GROUPS 64
+#define GROUP_SIZE(SECTORS) \
+  (((SECTORS) + SUPER_GROUPS - 1) / SUPER_GROUPS + 63) / 64 * 64
+
+#define NAME_MAX 14
+
+/* On-disk inode. */
+struct inode_disk
+{
+  fs_sec_t indirect_blocks[INDIRECT_COUNT];
+  int32_t length;
+  uint8_t isdir;
+  fs_sec_t pardir;
+  uint32_t magic;
+  uint32_t version; /* 0 until the kernel first opens it. */
+  uint8_t pad[SECTOR_SIZE - INDIRECT_COUNT * sizeof (fs_sec_t) - 16];
+};
+
+/* On-disk indirect block. */
+struct indirect_block
+{
+  fs_sec_t data_sectors[PTR_PER_SEC];
+};
+
+/* Directory entry. */
+struct dir_entry
+{
+  uint32_t inode_sector;
+  char name[NAME_MAX + 1];
+  uint8_t in_use;
+};
+
+/* Journal header. */
+struct journal_header
+{
+  uint32_t magic;
+  uint32_t cnt;
+  uint32_t home[JOURNAL_SLOTS];
+  uint8_t pad[SECTOR_SIZE - 8 - JOURNAL_SLOTS * 4];
+};
+
+/* Superblock. */
+struct superblock
+{
+  uint32_t magic;
+  uint32_t clean;
+  uint32_t sector_cnt;
+  uint32_t free_cnt;
+  uint32_t group_size;
+  uint32_t group_free[SUPER_GROUPS];
+  uint8_t pad[SECTOR_SIZE - 20 - SUPER_GROUPS * 4];
+};
+
+/* A file system partition inside an image file. */
+struct fs_image
+{
+  FILE *file;         /* Image file. */
+  const char *name;   /* Image file name, for messages. */
+  long offset;        /* Byte offset of the partition. */
+  uint32_t sectors;   /* Partition size in sectors. */
+};
+
+bool fs_image_open (struct fs_image *, const char *name, const char *mode);
+void fs_image_close (struct fs_image *);
+void fs_image_read (struct fs_image *, uint32_t sector, void *);
+void fs_image_write (struct fs_image *, uint32_t sector, const void *);
+
+/* Free map bits, in the layout of lib/kernel/bitmap.c: bit I is
+   bit I % 8 of byte I / 8, in 32-bit little-endian elements. */
+static inline size_t
+free_map_bytes (uint32_t sectors)
+{
+  return (sectors + 31) / 32 * 4;
+}
+
+static inline bool
+free_map_test (const uint8_t *map, uint32_t sector)
+{
+  return (map[sector / 8] >> (sector % 8)) & 1;
+}
+
+static inline void
+free_map_mark (uint8_t *map, uint32_t sector)
+{
+  map[sector / 8] |= 1 << (sector % 8);
+}
+
+#endif /* utils/pintos-fs.h */
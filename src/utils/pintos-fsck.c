@@ -0,0 +1,488 @@
+/* pintos-fsck: checks and profiles a Pintos file system image
+   without booting Pintos.
+
+   Walks the directory tree from the root, verifying inodes,
+   indirect blocks and directory entries against each other and
+   against the free map, then reports how files, directories and
+   free space are laid out. */
+
+#include "pintos-fs.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* What claims a sector. */
+enum sector_use
+{
+  USE_NONE,     /* Not referenced. */
+  USE_RESERVED, /* Free map inode, root inode, journal. */
+  USE_INODE,    /* An inode. */
+  USE_INDIRECT, /* An indirect block. */
+  USE_DATA      /* File or directory data. */
+};
+
+static struct fs_image img;
+static uint8_t *use;      /* enum sector_use of each sector. */
+static uint8_t *free_map; /* Free map as stored on disk. */
+static bool verbose;
+static int errors;
+
+/* Totals. */
+static unsigned file_cnt, dir_cnt, extent_cnt, fragmented_cnt;
+static unsigned long long byte_cnt, data_cnt;
+static unsigned max_extents, max_dir_entries;
+static char max_extents_path[1024], max_dir_path[1024];
+
+static void error (const char *, ...) __attribute__ ((format (printf, 1, 2)));
+
+static void
+error (const char *format, ...)
+{
+  va_list args;
+  printf ("error: ");
+  va_start (args, format);
+  vprintf (format, args);
+  va_end (args);
+  putchar ('\n');
+  errors++;
+}
+
+/* Records that sector SEC is used as USAGE by PATH.  Returns
+   false if SEC is out of range or already used. */
+static bool
+claim (uint32_t sec, enum sector_use usage, const char *path)
+{
+  if (sec >= img.sectors)
+    {
+      error ("%s: sector %u is beyond the end of the file system", path,
+             sec);
+      return false;
+    }
+  if (use[sec] != USE_NONE)
+    {
+      error ("%s: sector %u is already in use", path, sec);
+      return false;
+    }
+  use[sec] = usage;
+  return true;
+}
+
+/* An inode and the data sectors it maps. */
+struct file_map
+{
+  struct inode_disk disk;
+  fs_sec_t *data;  /* Data sectors, in file order. */
+  size_t data_cnt; /* Number of data sectors. */
+};
+
+/* Reads the inode at SECTOR for PATH, claims its sectors and
+   fills in MAP.  Returns false if the inode is unusable. */
+static bool
+load_file (uint32_t sector, const char *path, struct file_map *map)
+{
+  size_t indirect_cnt, i, j;
+
+  fs_image_read (&img, sector, &map->disk);
+  map->data = NULL;
+  map->data_cnt = 0;
+  if (map->disk.magic != INODE_MAGIC)
+    {
+      error ("%s: inode %u has bad magic %#x", path, sector, map->disk.magic);
+      return false;
+    }
+  if (map->disk.length < 0
+      || map->disk.length > (int32_t)FS_SECTORS * SECTOR_SIZE)
+    {
+      error ("%s: inode %u has bad length %d", path, sector,
+             map->disk.length);
+      return false;
+    }
+
+  map->data_cnt = (map->disk.length + SECTOR_SIZE - 1) / SECTOR_SIZE;
+  indirect_cnt = (map->data_cnt + PTR_PER_SEC - 1) / PTR_PER_SEC;
+  map->data = calloc (map->data_cnt + 1, sizeof *map->data);
+  if (map->data == NULL)
+    {
+      fprintf (stderr, "pintos-fsck: out of memory\n");
+      exit (2);
+    }
+
+  for (i = 0; i < INDIRECT_COUNT; i++)
+    {
+      fs_sec_t ind_sec = map->disk.indirect_blocks[i];
+      struct indirect_block ind;
+      size_t in_use;
+
+      if (i >= indirect_cnt)
+        {
+          if (ind_sec != ERR_SECTOR)
+            error ("%s: indirect pointer %zu is set beyond end of file",
+                   path, i);
+          continue;
+        }
+      if (ind_sec == ERR_SECTOR)
+        {
+          error ("%s: indirect block %zu is missing", path, i);
+          return false;
+        }
+      if (!claim (ind_sec, USE_INDIRECT, path))
+        return false;
+
+      fs_image_read (&img, ind_sec, &ind);
+      in_use = map->data_cnt - i * PTR_PER_SEC;
+      if (in_use > PTR_PER_SEC)
+        in_use = PTR_PER_SEC;
+      for (j = 0; j < PTR_PER_SEC; j++)
+        {
+          fs_sec_t sec = ind.data_sectors[j];
+          if (j >= in_use)
+            {
+              if (sec != ERR_SECTOR)
+                error ("%s: data pointer %zu is set beyond end of file", path,
+                       i * PTR_PER_SEC + j);
+            }
+          else if (sec == ERR_SECTOR)
+            {
+              error ("%s: data sector %zu is missing", path,
+                     i * PTR_PER_SEC + j);
+              return false;
+            }
+          else if (!claim (sec, USE_DATA, path))
+            return false;
+          else
+            map->data[i * PTR_PER_SEC + j] = sec;
+        }
+    }
+  return true;
+}
+
+/* Counts the runs of consecutive sectors in MAP's data. */
+static unsigned
+count_extents (const struct file_map *map)
+{
+  unsigned extents = map->data_cnt > 0;
+  size_t i;
+  for (i = 1; i < map->data_cnt; i++)
+    if (map->data[i] != map->data[i - 1] + 1)
+      extents++;
+  return extents;
+}
+
+static void check_dir (uint32_t sector, const char *path,
+                       struct file_map *map);
+
+/* Checks the file or directory at SECTOR, named PATH, whose
+   directory entry is in the directory at PARENT. */
+static void
+check_file (uint32_t sector, uint32_t parent, const char *path)
+{
+  struct file_map map;
+  unsigned extents;
+
+  if (!claim (sector, sector == ROOT_DIR_SECTOR ? USE_RESERVED : USE_INODE,
+              path))
+    return;
+  if (!load_file (sector, path, &map))
+    {
+      free (map.data);
+      return;
+    }
+  if (map.disk.pardir != parent)
+    error ("%s: parent is inode %u, but directory entry is in inode %u", path,
+           map.disk.pardir, parent);
+
+  extents = count_extents (&map);
+  extent_cnt += extents;
+  fragmented_cnt += extents > 1;
+  data_cnt += map.data_cnt;
+  byte_cnt += map.disk.length;
+  if (extents > max_extents)
+    {
+      max_extents = extents;
+      snprintf (max_extents_path, sizeof max_extents_path, "%s", path);
+    }
+  if (verbose)
+    printf ("%-40s %s %9d bytes %6zu sectors %4u extents\n", path,
+            map.disk.isdir ? "dir " : "file", map.disk.length, map.data_cnt,
+            extents);
+
+  if (map.disk.isdir)
+    {
+      dir_cnt++;
+      check_dir (sector, path, &map);
+    }
+  else
+    file_cnt++;
+  free (map.data);
+}
+
+/* Checks the entries of the directory at SECTOR, named PATH,
+   whose data is mapped by MAP, and recurses into them. */
+static void
+check_dir (uint32_t sector, const char *path, struct file_map *map)
+{
+  size_t entry_cnt = map->disk.length / sizeof (struct dir_entry);
+  size_t buf_size = map->data_cnt * SECTOR_SIZE;
+  uint8_t *buf = malloc (buf_size + 1);
+  unsigned in_use = 0;
+  size_t i, j;
+
+  if (buf == NULL)
+    {
+      fprintf (stderr, "pintos-fsck: out of memory\n");
+      exit (2);
+    }
+  for (i = 0; i < map->data_cnt; i++)
+    fs_image_read (&img, map->data[i], buf + i * SECTOR_SIZE);
+
+  for (i = 0; i < entry_cnt; i++)
+    {
+      struct dir_entry *e = (struct dir_entry *)buf + i;
+      char child[1024];
+
+      if (!e->in_use)
+        continue;
+      in_use++;
+      if (memchr (e->name, '\0', sizeof e->name) == NULL || e->name[0] == '\0'
+          || strchr (e->name, '/') != NULL)
+        {
+          error ("%s: entry %zu has a bad name", path, i);
+          continue;
+        }
+      for (j = 0; j < i; j++)
+        {
+          struct dir_entry *prev = (struct dir_entry *)buf + j;
+          if (prev->in_use && !strcmp (prev->name, e->name))
+            error ("%s: name \"%s\" appears twice", path, e->name);
+        }
+      snprintf (child, sizeof child, "%s%s%s", path,
+                path[strlen (path) - 1] == '/' ? "" : "/", e->name);
+      check_file (e->inode_sector, sector, child);
+    }
+
+  if (in_use > max_dir_entries)
+    {
+      max_dir_entries = in_use;
+      snprintf (max_dir_path, sizeof max_dir_path, "%s", path);
+    }
+  if (verbose)
+    printf ("%-40s %u of %zu entries in use\n", path, in_use, entry_cnt);
+  free (buf);
+}
+
+/* Loads the free map from its file and claims its sectors. */
+static void
+load_free_map (void)
+{
+  struct file_map map;
+  size_t bytes = free_map_bytes (img.sectors), i;
+
+  use[FREE_MAP_SECTOR] = USE_RESERVED;
+  if (!load_file (FREE_MAP_SECTOR, "<free map>", &map))
+    {
+      fprintf (stderr, "pintos-fsck: %s: cannot read free map\n", img.name);
+      exit (1);
+    }
+  if ((size_t)map.disk.length < bytes)
+    {
+      error ("<free map>: file is %d bytes, expected %zu", map.disk.length,
+             bytes);
+      exit (1);
+    }
+  free_map = malloc (map.data_cnt * SECTOR_SIZE);
+  if (free_map == NULL)
+    {
+      fprintf (stderr, "pintos-fsck: out of memory\n");
+      exit (2);
+    }
+  for (i = 0; i < map.data_cnt; i++)
+    fs_image_read (&img, map.data[i], free_map + i * SECTOR_SIZE);
+  free (map.data);
+}
+
+/* Reports on the journal, which the kernel replays on mount. */
+static void
+check_journal (void)
+{
+  struct journal_header h;
+  uint32_t i;
+
+  for (i = JOURNAL_SECTOR; i < JOURNAL_SECTOR + JOURNAL_SECTORS; i++)
+    claim (i, USE_RESERVED, "<journal>");
+  fs_image_read (&img, JOURNAL_SECTOR, &h);
+  if (h.magic != JOURNAL_MAGIC || h.cnt > JOURNAL_SLOTS)
+    error ("<journal>: bad journal header");
+  else if (h.cnt > 0)
+    printf ("journal: %u committed records not yet replayed; errors below "
+            "may be repaired by mounting the image\n",
+            h.cnt);
+  else
+    printf ("journal: empty\n");
+}
+
+/* Reports whether the file system was unmounted cleanly.  If so,
+   the kernel trusts the superblock's free counts instead of
+   reading the free map, so they must match it. */
+static void
+check_super (void)
+{
+  struct superblock sb;
+  uint32_t group_size = GROUP_SIZE (img.sectors), sec;
+  uint32_t free_cnt = 0, group_free[SUPER_GROUPS] = { 0 };
+  unsigned i;
+
+  claim (SUPER_SECTOR, USE_RESERVED, "<superblock>");
+  fs_image_read (&img, SUPER_SECTOR, &sb);
+  if (sb.magic != SUPER_MAGIC)
+    {
+      error ("<superblock>: bad magic %#x", sb.magic);
+      return;
+    }
+  if (!sb.clean)
+    {
+      printf ("superblock: not unmounted cleanly, the kernel will rescan "
+              "the free map on mount\n");
+      return;
+    }
+  printf ("superblock: unmounted cleanly\n");
+  if (sb.sector_cnt != img.sectors || sb.group_size != group_size)
+    {
+      error ("<superblock>: made for %u sectors", sb.sector_cnt);
+      return;
+    }
+  for (sec = 0; sec < img.sectors; sec++)
+    if (!free_map_test (free_map, sec))
+      {
+        free_cnt++;
+        group_free[sec / group_size]++;
+      }
+  if (sb.free_cnt != free_cnt)
+    error ("<superblock>: %u free sectors, free map has %u", sb.free_cnt,
+           free_cnt);
+  for (i = 0; i < SUPER_GROUPS; i++)
+    if (sb.group_free[i] != group_free[i])
+      error ("<superblock>: group %u has %u free sectors, free map has %u", i,
+             sb.group_free[i], group_free[i]);
+}
+
+/* Compares the sectors in use with the free map, and reports the
+   layout of free space. */
+static void
+check_free_space (void)
+{
+  static const unsigned bounds[] = { 1, 8, 64, 512, 4096 };
+  unsigned histogram[6] = { 0 };
+  unsigned free_cnt = 0, free_extents = 0, largest = 0, run = 0, leaked = 0;
+  uint32_t sec;
+  size_t i;
+
+  for (sec = 0; sec <= img.sectors; sec++)
+    {
+      bool is_free = sec < img.sectors && !free_map_test (free_map, sec);
+      if (sec < img.sectors)
+        {
+          if (use[sec] != USE_NONE && is_free)
+            error ("sector %u is in use but free in the free map", sec);
+          else if (use[sec] == USE_NONE && !is_free)
+            leaked++;
+        }
+      if (is_free)
+        {
+          free_cnt++;
+          run++;
+          continue;
+        }
+      if (run > 0)
+        {
+          free_extents++;
+          if (run > largest)
+            largest = run;
+          for (i = 0; i < 5 && run >= bounds[i]; i++)
+            ;
+          histogram[i - 1]++;
+          run = 0;
+        }
+    }
+
+  if (leaked > 0)
+    printf ("warning: %u sectors are allocated but not referenced\n", leaked);
+  printf ("free space: %u of %u sectors in %u extents, largest %u sectors\n",
+          free_cnt, img.sectors, free_extents, largest);
+  printf ("  free extent sizes:");
+  for (i = 0; i < 5; i++)
+    if (i < 4)
+      printf (" %u-%u:%u", bounds[i], bounds[i + 1] - 1, histogram[i]);
+    else
+      printf (" %u+:%u", bounds[i], histogram[i]);
+  printf ("\n");
+}
+
+static void
+usage (int exit_code)
+{
+  printf ("pintos-fsck, checks and profiles a Pintos file system image\n"
+          "Usage: pintos-fsck [-v] IMAGE\n"
+          "where IMAGE is a partitioned disk with a file system partition,\n"
+          "or a bare file system partition.\n"
+          "  -v  List every file and directory.\n"
+          "Exit status is 0 if the file system is consistent, 1 if errors\n"
+          "were found, 2 on trouble reading the image.\n");
+  exit (exit_code);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int i;
+  const char *name = NULL;
+
+  for (i = 1; i < argc; i++)
+    if (!strcmp (argv[i], "-v"))
+      verbose = true;
+    else if (!strcmp (argv[i], "-h") || !strcmp (argv[i], "--help"))
+      usage (0);
+    else if (name == NULL)
+      name = argv[i];
+    else
+      usage (2);
+  if (name == NULL)
+    usage (2);
+
+  if (!fs_image_open (&img, name, "rb"))
+    return 2;
+  printf ("%s: %u sectors (%.1f MB)\n", name, img.sectors,
+          img.sectors * (double)SECTOR_SIZE / (1024 * 1024));
+  use = calloc (img.sectors, 1);
+  if (use == NULL)
+    {
+      fprintf (stderr, "pintos-fsck: out of memory\n");
+      return 2;
+    }
+
+  load_free_map ();
+  check_super ();
+  check_journal ();
+  check_file (ROOT_DIR_SECTOR, ROOT_DIR_SECTOR, "/");
+  check_free_space ();
+
+  printf ("%u directories, %u files, %llu bytes in %llu data sectors\n",
+          dir_cnt, file_cnt, byte_cnt, data_cnt);
+  if (dir_cnt + file_cnt > 0)
+    printf ("fragmentation: %u of %u files and directories in more than "
+            "one extent, %.2f extents each, most is %u (%s)\n",
+            fragmented_cnt, dir_cnt + file_cnt,
+            (double)extent_cnt / (dir_cnt + file_cnt), max_extents,
+            max_extents_path);
+  if (dir_cnt > 0)
+    printf ("largest directory: %s with %u entries\n", max_dir_path,
+            max_dir_entries);
+
+  fs_image_close (&img);
+  if (errors > 0)
+    {
+      printf ("%d errors found\n", errors);
+      return 1;
+    }
+  printf ("file system is consistent\n");
+  return 0;
+}
@@ -0,0 +1,442 @@
+/* pintos-mkfs: builds a formatted Pintos file system image from a
+   host directory tree, without booting Pintos.
+
+   Every file and directory gets its inode, then its indirect
+   blocks, then its data in one run of consecutive sectors, in
+   depth-first order, so that the image starts out unfragmented.
+   The result is a bare file system partition, for use with
+   "pintos --filesys=IMAGE" or "pintos-mkdisk --filesys=IMAGE". */
+
+#include "pintos-fs.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Largest file system that 16-bit sector numbers can address. */
+#define MAX_SECTORS ((uint32_t)ERR_SECTOR)
+
+/* Default size: room for the contents plus half as much again,
+   but at least 2 MB. */
+#define MIN_SECTORS (2 * 1024 * 1024 / SECTOR_SIZE)
+
+/* Entries a directory has room for, like the root directory made
+   by the kernel's do_format(). */
+#define DIR_ENTRIES 16
+
+/* A file or directory to put in the image. */
+struct node
+{
+  char name[NAME_MAX + 1]; /* Name in parent directory. */
+  char *path;              /* Host path. */
+  bool isdir;              /* Directory? */
+  uint32_t length;         /* File length in bytes. */
+  struct node **children;  /* Directory entries, sorted by name. */
+  size_t child_cnt;        /* Number of directory entries. */
+
+  /* Layout. */
+  uint32_t inode;    /* Inode sector. */
+  uint32_t indirect; /* First of the indirect blocks. */
+  uint32_t data;     /* First of the data sectors. */
+};
+
+static int errors;
+static unsigned file_cnt, dir_cnt;
+static uint32_t next_sector; /* Next sector to lay out. */
+
+static void *
+xmalloc (size_t size)
+{
+  void *p = malloc (size);
+  if (p == NULL)
+    {
+      fprintf (stderr, "pintos-mkfs: out of memory\n");
+      exit (2);
+    }
+  return p;
+}
+
+static uint32_t
+div_round_up (uint32_t x, uint32_t y)
+{
+  return (x + y - 1) / y;
+}
+
+/* Sectors taken by a file of LENGTH bytes, including its indirect
+   blocks but not its inode. */
+static uint32_t
+file_sectors (uint32_t length)
+{
+  uint32_t data = div_round_up (length, SECTOR_SIZE);
+  return div_round_up (data, PTR_PER_SEC) + data;
+}
+
+static int
+compare_nodes (const void *a_, const void *b_)
+{
+  const struct node *const *a = a_;
+  const struct node *const *b = b_;
+  return strcmp ((*a)->name, (*b)->name);
+}
+
+/* Reads the host file or directory at PATH into a new node named
+   NAME.  Returns a null pointer if PATH is to be skipped. */
+static struct node *
+scan (const char *path, const char *name)
+{
+  struct stat st;
+  struct node *n;
+
+  if (stat (path, &st) != 0)
+    {
+      fprintf (stderr, "%s: stat: %s\n", path, strerror (errno));
+      errors++;
+      return NULL;
+    }
+  if (!S_ISDIR (st.st_mode) && !S_ISREG (st.st_mode))
+    {
+      fprintf (stderr, "%s: skipping, not a file or directory\n", path);
+      return NULL;
+    }
+  if (strlen (name) > NAME_MAX)
+    {
+      fprintf (stderr, "%s: name longer than %d characters\n", path,
+               NAME_MAX);
+      errors++;
+      return NULL;
+    }
+
+  n = xmalloc (sizeof *n);
+  memset (n, 0, sizeof *n);
+  strcpy (n->name, name);
+  n->path = strdup (path);
+  n->isdir = S_ISDIR (st.st_mode);
+  if (!n->isdir)
+    {
+      if (st.st_size > (off_t)FS_SECTORS * SECTOR_SIZE)
+        {
+          fprintf (stderr, "%s: larger than %d bytes\n", path,
+                   FS_SECTORS * SECTOR_SIZE);
+          errors++;
+        }
+      n->length = st.st_size;
+      file_cnt++;
+    }
+  else
+    {
+      DIR *dir = opendir (path);
+      struct dirent *de;
+      size_t capacity = 0;
+
+      if (dir == NULL)
+        {
+          fprintf (stderr, "%s: opendir: %s\n", path, strerror (errno));
+          errors++;
+          return n;
+        }
+      while ((de = readdir (dir)) != NULL)
+        {
+          char *child_path;
+          struct node *child;
+
+          if (!strcmp (de->d_name, ".") || !strcmp (de->d_name, ".."))
+            continue;
+          child_path = xmalloc (strlen (path) + strlen (de->d_name) + 2);
+          sprintf (child_path, "%s/%s", path, de->d_name);
+          child = scan (child_path, de->d_name);
+          free (child_path);
+          if (child == NULL)
+            continue;
+          if (n->child_cnt == capacity)
+            {
+              capacity = capacity ? capacity * 2 : 16;
+              n->children = realloc (n->children,
+                                     capacity * sizeof *n->children);
+              if (n->children == NULL)
+                {
+                  fprintf (stderr, "pintos-mkfs: out of memory\n");
+                  exit (2);
+                }
+            }
+          n->children[n->child_cnt++] = child;
+        }
+      closedir (dir);
+      qsort (n->children, n->child_cnt, sizeof *n->children, compare_nodes);
+
+      n->length = (n->child_cnt > DIR_ENTRIES ? n->child_cnt : DIR_ENTRIES)
+                  * sizeof (struct dir_entry);
+      if (n->length > FS_SECTORS * SECTOR_SIZE)
+        {
+          fprintf (stderr, "%s: too many entries\n", path);
+          errors++;
+        }
+      dir_cnt++;
+    }
+  return n;
+}
+
+/* Sectors needed by N and everything below it. */
+static uint32_t
+tree_sectors (const struct node *n, bool is_root)
+{
+  uint32_t sectors = file_sectors (n->length) + !is_root;
+  size_t i;
+  for (i = 0; i < n->child_cnt; i++)
+    sectors += tree_sectors (n->children[i], false);
+  return sectors;
+}
+
+/* Lays out N's indirect blocks and data at the next free
+   sectors. */
+static void
+place_data (struct node *n)
+{
+  uint32_t data = div_round_up (n->length, SECTOR_SIZE);
+  n->indirect = next_sector;
+  n->data = n->indirect + div_round_up (data, PTR_PER_SEC);
+  next_sector = n->data + data;
+}
+
+/* Lays out N's data and the subtree below it.  N's inode sector
+   must already be assigned. */
+static void
+place_tree (struct node *n)
+{
+  size_t i;
+  place_data (n);
+  for (i = 0; i < n->child_cnt; i++)
+    {
+      n->children[i]->inode = next_sector++;
+      place_tree (n->children[i]);
+    }
+}
+
+/* Writes the inode and indirect blocks of a file of LENGTH bytes
+   laid out at INODE, INDIRECT and DATA, with parent directory
+   PARDIR. */
+static void
+write_inode (struct fs_image *img, uint32_t inode, uint32_t indirect,
+             uint32_t data, uint32_t length, bool isdir, uint32_t pardir)
+{
+  struct inode_disk disk;
+  struct indirect_block ind;
+  uint32_t data_cnt = div_round_up (length, SECTOR_SIZE);
+  uint32_t i, j;
+
+  memset (&disk, 0, sizeof disk);
+  for (i = 0; i < INDIRECT_COUNT; i++)
+    disk.indirect_blocks[i] = ERR_SECTOR;
+  disk.length = length;
+  disk.isdir = isdir;
+  disk.pardir = pardir;
+  disk.magic = INODE_MAGIC;
+
+  for (i = 0; i * PTR_PER_SEC < data_cnt; i++)
+    {
+      disk.indirect_blocks[i] = indirect + i;
+      for (j = 0; j < PTR_PER_SEC; j++)
+        ind.data_sectors[j] = i * PTR_PER_SEC + j < data_cnt
+                                  ? data + i * PTR_PER_SEC + j
+                                  : ERR_SECTOR;
+      fs_image_write (img, indirect + i, &ind);
+    }
+  fs_image_write (img, inode, &disk);
+}
+
+/* Writes N and the subtree below it, N's directory entry being in
+   the directory at PARDIR. */
+static void
+write_tree (struct fs_image *img, const struct node *n, uint32_t pardir)
+{
+  uint8_t buf[SECTOR_SIZE];
+  uint32_t data_cnt = div_round_up (n->length, SECTOR_SIZE);
+  uint32_t i;
+
+  write_inode (img, n->inode, n->indirect, n->data, n->length, n->isdir,
+               pardir);
+  if (n->isdir)
+    {
+      uint8_t *entries = xmalloc (data_cnt * SECTOR_SIZE);
+      memset (entries, 0, data_cnt * SECTOR_SIZE);
+      for (i = 0; i < n->child_cnt; i++)
+        {
+          struct dir_entry *e = (struct dir_entry *)entries + i;
+          e->inode_sector = n->children[i]->inode;
+          strcpy (e->name, n->children[i]->name);
+          e->in_use = true;
+        }
+      for (i = 0; i < data_cnt; i++)
+        fs_image_write (img, n->data + i, entries + i * SECTOR_SIZE);
+      free (entries);
+
+      for (i = 0; i < n->child_cnt; i++)
+        write_tree (img, n->children[i], n->inode);
+    }
+  else
+    {
+      FILE *file = fopen (n->path, "rb");
+      if (file == NULL)
+        {
+          fprintf (stderr, "%s: open: %s\n", n->path, strerror (errno));
+          exit (2);
+        }
+      for (i = 0; i < data_cnt; i++)
+        {
+          size_t n_read = fread (buf, 1, SECTOR_SIZE, file);
+          if (n_read < SECTOR_SIZE && i + 1 < data_cnt)
+            {
+              fprintf (stderr, "%s: file shrank while reading\n", n->path);
+              exit (2);
+            }
+          memset (buf + n_read, 0, SECTOR_SIZE - n_read);
+          fs_image_write (img, n->data + i, buf);
+        }
+      fclose (file);
+    }
+}
+
+static void
+usage (int exit_code)
+{
+  printf ("pintos-mkfs, builds a Pintos file system image from a directory\n"
+          "Usage: pintos-mkfs [-s SIZE] IMAGE DIR\n"
+          "where IMAGE is the file system image to create, and the\n"
+          "contents of DIR become the root directory of the image.\n"
+          "  -s SIZE  Make the file system SIZE MB (default: fit DIR\n"
+          "           with 50%% free space, at least 2 MB)\n"
+          "The image is a bare file system partition: pass it to\n"
+          "\"pintos --filesys=IMAGE\" or \"pintos-mkdisk --filesys=IMAGE\".\n");
+  exit (exit_code);
+}
+
+int
+main (int argc, char *argv[])
+{
+  const char *image_name, *dir_name;
+  double size_mb = 0.0;
+  struct node *root;
+  uint32_t sectors, used, fm_bytes, fm_sectors, fm_indirect;
+  struct fs_image img;
+  struct journal_header journal;
+  struct superblock super;
+  uint8_t *free_map;
+  FILE *file;
+  int opt;
+  uint32_t i;
+
+  while ((opt = getopt (argc, argv, "s:h")) != -1)
+    switch (opt)
+      {
+      case 's':
+        size_mb = atof (optarg);
+        if (size_mb <= 0)
+          usage (1);
+        break;
+      case 'h':
+        usage (0);
+        break;
+      default:
+        usage (1);
+      }
+  if (argc - optind != 2)
+    usage (1);
+  image_name = argv[optind];
+  dir_name = argv[optind + 1];
+
+  if (access (image_name, F_OK) == 0)
+    {
+      fprintf (stderr, "%s: already exists\n", image_name);
+      return 1;
+    }
+  root = scan (dir_name, "");
+  if (root == NULL || !root->isdir)
+    {
+      fprintf (stderr, "%s: not a directory\n", dir_name);
+      return 1;
+    }
+  if (errors > 0)
+    return 1;
+
+  /* Size the file system, assuming the largest possible free map
+     when choosing the size. */
+  used = JOURNAL_SECTOR + JOURNAL_SECTORS + tree_sectors (root, true)
+         + file_sectors (free_map_bytes (MAX_SECTORS));
+  if (size_mb > 0)
+    sectors = size_mb * (1024 * 1024 / SECTOR_SIZE);
+  else
+    {
+      sectors = used + used / 2;
+      if (sectors < MIN_SECTORS)
+        sectors = MIN_SECTORS;
+      if (sectors > MAX_SECTORS)
+        sectors = MAX_SECTORS;
+    }
+  if (sectors > MAX_SECTORS)
+    {
+      fprintf (stderr, "pintos-mkfs: file system larger than %u sectors\n",
+               MAX_SECTORS);
+      return 1;
+    }
+
+  /* Lay out the free map, then the root directory tree. */
+  fm_bytes = free_map_bytes (sectors);
+  fm_sectors = div_round_up (fm_bytes, SECTOR_SIZE);
+  fm_indirect = JOURNAL_SECTOR + JOURNAL_SECTORS;
+  next_sector = fm_indirect + div_round_up (fm_sectors, PTR_PER_SEC)
+                + fm_sectors;
+  root->inode = ROOT_DIR_SECTOR;
+  place_tree (root);
+  if (next_sector > sectors)
+    {
+      fprintf (stderr,
+               "pintos-mkfs: %s needs %u sectors, file system has %u\n",
+               dir_name, next_sector, sectors);
+      return 1;
+    }
+
+  /* Create the image. */
+  file = fopen (image_name, "wb");
+  if (file == NULL || ftruncate (fileno (file), (off_t)sectors * SECTOR_SIZE)
+      || fclose (file))
+    {
+      fprintf (stderr, "%s: create: %s\n", image_name, strerror (errno));
+      return 2;
+    }
+  if (!fs_image_open (&img, image_name, "r+b"))
+    return 2;
+
+  memset (&journal, 0, sizeof journal);
+  journal.magic = JOURNAL_MAGIC;
+  fs_image_write (&img, JOURNAL_SECTOR, &journal);
+
+  write_tree (&img, root, ROOT_DIR_SECTOR);
+
+  free_map = xmalloc (fm_sectors * SECTOR_SIZE);
+  memset (free_map, 0, fm_sectors * SECTOR_SIZE);
+  for (i = 0; i < next_sector; i++)
+    free_map_mark (free_map, i);
+  write_inode (&img, FREE_MAP_SECTOR, fm_indirect,
+               fm_indirect + div_round_up (fm_sectors, PTR_PER_SEC),
+               fm_bytes, false, FREE_MAP_SECTOR);
+  for (i = 0; i < fm_sectors; i++)
+    fs_image_write (&img,
+                    fm_indirect + div_round_up (fm_sectors, PTR_PER_SEC) + i,
+                    free_map + i * SECTOR_SIZE);
+
+  memset (&super, 0, sizeof super);
+  super.magic = SUPER_MAGIC;
+  super.clean = 1;
+  super.sector_cnt = sectors;
+  super.free_cnt = sectors - next_sector;
+  super.group_size = GROUP_SIZE (sectors);
+  for (i = next_sector; i < sectors; i++)
+    super.group_free[i / super.group_size]++;
+  fs_image_write (&img, SUPER_SECTOR, &super);
+  fs_image_close (&img);
+
+  printf ("%s: %u directories, %u files in %u of %u sectors\n", image_name,
+          dir_cnt, file_cnt, next_sector, sectors);
+  return 0;
+}
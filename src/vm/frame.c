@@ -8,7 +8,9 @@
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
 #include "userprog/syscall.h"
+#include "vm/sup_page.h"
 #include "vm/swap.h"
+#include <string.h>
 
 #define FRAME_CRITICAL                                                        \
   for (int i = (lock_acquire (&frame_lock), 0); i < 1;                        \
@@ -21,6 +23,21 @@ static struct hash frame_hash;
 static struct list frame_list;
 static struct list_elem *clock_pointer;
 
+/* Frames holding read-only file pages, keyed by inode, offset
+   and length, so that processes running the same program share
+   its text.  Guarded by frame_lock, since eviction removes the
+   frames it takes. */
+static struct hash share_hash;
+
+/* Frames shared copy-on-write, which stay pinned, and frames held
+   by asynchronous I/O.  fork() and aio_enter() fail rather than
+   let them take more than half of the user pool, so that eviction
+   always has frames to choose from.  Guarded by frame_lock. */
+static size_t cow_frames;
+static size_t held_frames;
+static hash_hash_func share_hash_function;
+static hash_less_func share_less_function;
+
 static hash_hash_func page_hash_function;
 static hash_less_func page_less_function;
 
@@ -29,6 +46,10 @@ static struct vm_frame *new_frame (void *kpage, void *upage,
 
 /* The function to choose a frame to swap */
 static struct vm_frame *frame_get_victim (void);
+static bool frame_may_pin (void);
+static bool frame_accessed (struct vm_frame *);
+static void frame_evict (struct vm_frame *);
+static void frame_evict_shared (struct vm_frame *);
 static void vm_frame_clock_pointer_proceed (void);
 
 /* get the vm_frame according to the kpage */
@@ -42,6 +63,7 @@ vm_frame_init ()
   list_init (&frame_list);
   hash_init (&frame_hash, page_hash_function, page_less_function, NULL);
   clock_pointer = list_tail (&frame_list);
+  hash_init (&share_hash, share_hash_function, share_less_function, NULL);
 }
 
 /* Allocate frame.
@@ -72,32 +94,22 @@ vm_frame_allocate (enum palloc_flags flags, void *page_addr)
       {
         // Try to get a page to evict
         struct vm_frame *victim = frame_get_victim ();
-        struct thread *owner_old = victim->owner;
-
-        // write down to swap
-        swap_idx swap_slot = vm_swap_save (victim->phy_addr);
-
-        // remove the page-frame mapping for the owner
-        struct sup_page_entry *entry = vm_sup_page_find_entry (
-            owner_old->supplemental_table, victim->upage_addr);
-        ASSERT (entry);
-        // if the evicted frame is a mmap page, writeback
-        if (entry->mapped
-            && pagedir_is_dirty (owner_old->pagedir, entry->upage))
-          vm_sup_page_writeback (entry);
-        pagedir_clear_page (owner_old->pagedir, victim->upage_addr);
-        entry->status = ON_SWAP;
-        entry->kpage = NULL;
-        entry->swap_slot = swap_slot;
+        if (victim != NULL)
+          {
+            if (victim->inode != NULL)
+              frame_evict_shared (victim);
+            else
+              frame_evict (victim);
 
-        // reuse the frame
-        frame = victim;
-        frame->owner = thread_current ();
-        frame->upage_addr = page_addr;
-        frame_page = frame->phy_addr;
-        // clear the frame, wait for loading data into it
-        memset (frame_page, 0, PGSIZE);
-        frame->pin = true;
+            // reuse the frame
+            frame = victim;
+            frame->owner = thread_current ();
+            frame->upage_addr = page_addr;
+            frame_page = frame->phy_addr;
+            // clear the frame, wait for loading data into it
+            memset (frame_page, 0, PGSIZE);
+            frame->pin = true;
+          }
       }
     }
 
@@ -149,6 +161,7 @@ vm_frame_free (void *kpage, bool free_resource)
 /* This function implement the Second Chance (or Clock) implementation
  * algorithm. Described here:
  * https://en.wikipedia.org/wiki/Page_replacement_algorithm#Clock
+ * Returns NULL if every frame is pinned.
  */
 static struct vm_frame *
 frame_get_victim ()
@@ -166,28 +179,366 @@ frame_get_victim ()
       vm_frame_clock_pointer_proceed ();
       struct vm_frame *frame
           = list_entry (clock_pointer, struct vm_frame, list_elem);
-      void *upage = frame->upage_addr;
 
-      if (frame->pin)
+      if (frame->pin || frame->hold_cnt > 0)
         continue;
-      uint32_t *pd = frame->owner->pagedir;
-      ASSERT (pd != NULL);
-      if (!pagedir_is_accessed (pd, upage))
+      // Give a second chance
+      if (!frame_accessed (frame))
         {
           intr_set_level (old_level);
           return frame;
         }
-      else
-        {
-          // Give a second chance
-          pagedir_set_accessed (pd, upage, false);
-        }
     }
   intr_set_level (old_level);
-  PANIC ("[VM.FRAME] can evict no frame");
   return NULL;
 }
 
+/* Returns whether another frame may stay pinned for long, shared
+   copy-on-write or held by asynchronous I/O. */
+static bool
+frame_may_pin (void)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  return cow_frames + held_frames < palloc_user_page_cnt () / 2;
+}
+
+/* Returns whether any process mapping FRAME accessed it since the
+   last call, and clears the accessed bits. */
+static bool
+frame_accessed (struct vm_frame *frame)
+{
+  bool accessed = false;
+
+  if (frame->inode == NULL)
+    {
+      uint32_t *pd = frame->owner->pagedir;
+      ASSERT (pd != NULL);
+      accessed = pagedir_is_accessed (pd, frame->upage_addr);
+      pagedir_set_accessed (pd, frame->upage_addr, false);
+      return accessed;
+    }
+  for (struct list_elem *e = list_begin (&frame->sharers);
+       e != list_end (&frame->sharers); e = list_next (e))
+    {
+      struct sup_page_entry *entry
+          = list_entry (e, struct sup_page_entry, share_elem);
+      if (pagedir_is_accessed (entry->share_pd, entry->upage))
+        {
+          accessed = true;
+          pagedir_set_accessed (entry->share_pd, entry->upage, false);
+        }
+    }
+  return accessed;
+}
+
+/* Saves private frame VICTIM to SWAP and unmaps it from its
+   owner. */
+static void
+frame_evict (struct vm_frame *victim)
+{
+  struct thread *owner_old = victim->owner;
+
+  // write down to swap
+  swap_idx swap_slot = vm_swap_save (victim->phy_addr);
+
+  // remove the page-frame mapping for the owner
+  struct sup_page_entry *entry = vm_sup_page_find_entry (
+      owner_old->supplemental_table, victim->upage_addr);
+  ASSERT (entry);
+  // if the evicted frame is a mmap page, writeback
+  if (entry->mapped && pagedir_is_dirty (owner_old->pagedir, entry->upage))
+    vm_sup_page_writeback (entry);
+  pagedir_clear_page (owner_old->pagedir, victim->upage_addr);
+  entry->status = ON_SWAP;
+  entry->kpage = NULL;
+  entry->swap_slot = swap_slot;
+}
+
+/* Unmaps shared frame VICTIM from every process.  The page is
+   read-only, so it is not saved: each process reads it from the
+   file again on its next access. */
+static void
+frame_evict_shared (struct vm_frame *victim)
+{
+  while (!list_empty (&victim->sharers))
+    {
+      struct sup_page_entry *entry = list_entry (
+          list_pop_front (&victim->sharers), struct sup_page_entry,
+          share_elem);
+      pagedir_clear_page (entry->share_pd, entry->upage);
+      entry->status = IN_FILE;
+      entry->kpage = NULL;
+      entry->shared = false;
+    }
+  hash_delete (&share_hash, &victim->share_elem);
+  victim->inode = NULL;
+}
+
+/* Maps shared frame FRAME read-only at ENTRY's page in PD and
+   records ENTRY as one of its sharers.  Returns false if out of
+   memory. */
+static bool
+frame_add_sharer (struct vm_frame *frame, struct sup_page_entry *entry,
+                  uint32_t *pd)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  if (!pagedir_set_page (pd, entry->upage, frame->phy_addr, false))
+    return false;
+  pagedir_set_dirty (pd, entry->upage, false);
+  list_push_back (&frame->sharers, &entry->share_elem);
+  entry->status = LOADED;
+  entry->kpage = frame->phy_addr;
+  entry->writable = false;
+  entry->shared = true;
+  entry->share_pd = pd;
+  return true;
+}
+
+/* Maps read-only IN_FILE page ENTRY in PD from the frame holding
+   the same bytes of the same file for other processes, or reads
+   it into a new frame if no process has it yet.  Returns false if
+   out of memory or the read fails. */
+bool
+vm_frame_map_shared (struct sup_page_entry *entry, uint32_t *pd)
+{
+  struct vm_frame key, *frame;
+  struct hash_elem *e;
+  struct file *f = entry->lazy_load.f;
+  uint32_t len = entry->lazy_load.len;
+  void *kpage;
+  bool success;
+
+  ASSERT (entry->status == IN_FILE && !entry->lazy_load.w);
+  key.inode = file_get_inode (f);
+  key.ofs = entry->lazy_load.ofs;
+  key.len = len;
+
+  FRAME_CRITICAL
+  {
+    e = hash_find (&share_hash, &key.share_elem);
+    success = e != NULL
+              && frame_add_sharer (
+                  hash_entry (e, struct vm_frame, share_elem), entry, pd);
+  }
+  if (e != NULL)
+    return success;
+
+  // read the page without holding the frame lock
+  kpage = vm_frame_allocate (PAL_USER, entry->upage);
+  if (kpage == NULL)
+    return false;
+  if (file_read_at (f, kpage, len, key.ofs) != (off_t)len)
+    {
+      vm_frame_free (kpage, true);
+      return false;
+    }
+  memset (kpage + len, 0, PGSIZE - len);
+
+  FRAME_CRITICAL
+  {
+    // another process may have read the page meanwhile
+    e = hash_find (&share_hash, &key.share_elem);
+    if (e != NULL)
+      frame = hash_entry (e, struct vm_frame, share_elem);
+    else
+      {
+        frame = frame_find_entry (kpage);
+        frame->inode = key.inode;
+        frame->ofs = key.ofs;
+        frame->len = len;
+        list_init (&frame->sharers);
+        hash_insert (&share_hash, &frame->share_elem);
+      }
+    success = frame_add_sharer (frame, entry, pd);
+    if (e == NULL && !success)
+      {
+        hash_delete (&share_hash, &frame->share_elem);
+        frame->inode = NULL;
+      }
+    frame->pin = false;
+  }
+  if (e != NULL || !success)
+    vm_frame_free (kpage, true);
+  return success;
+}
+
+/* Maps the shared frame holding PARENT's page at CHILD's page in
+   PD too, for a forked process.  Returns false if the page is no
+   longer in a frame, because it has been evicted, or out of
+   memory. */
+bool
+vm_frame_fork_shared (struct sup_page_entry *parent,
+                      struct sup_page_entry *child, uint32_t *pd)
+{
+  bool success = false;
+
+  // eviction changes PARENT under the frame lock
+  FRAME_CRITICAL
+  {
+    if (parent->status == LOADED && parent->shared)
+      success = frame_add_sharer (frame_find_entry (parent->kpage), child,
+                                  pd);
+  }
+  return success;
+}
+
+/* Unmaps shared page ENTRY and drops it from its frame's sharers,
+   freeing the frame with the last one.  Does nothing if the frame
+   has been evicted. */
+void
+vm_frame_put_shared (struct sup_page_entry *entry)
+{
+  void *kpage = NULL;
+
+  FRAME_CRITICAL
+  {
+    if (entry->status == LOADED && entry->shared)
+      {
+        struct vm_frame *frame = frame_find_entry (entry->kpage);
+        ASSERT (frame != NULL && frame->inode != NULL);
+        pagedir_clear_page (entry->share_pd, entry->upage);
+        list_remove (&entry->share_elem);
+        entry->status = IN_FILE;
+        entry->kpage = NULL;
+        entry->shared = false;
+        if (list_empty (&frame->sharers))
+          {
+            hash_delete (&share_hash, &frame->share_elem);
+            frame->inode = NULL;
+            kpage = frame->phy_addr;
+          }
+      }
+  }
+  if (kpage != NULL)
+    vm_frame_free (kpage, true);
+}
+
+/* Shares the frame holding ENTRY's page, in process OWNER, with
+   a forked process: makes OWNER's mapping read-only and marks
+   ENTRY copy-on-write.  Returns the frame, or NULL if the page
+   is not in a frame, because it was never loaded or has been
+   evicted, or if too many frames are shared this way already. */
+void *
+vm_frame_share_cow (struct thread *owner, struct sup_page_entry *entry)
+{
+  void *kpage = NULL;
+
+  // eviction changes ENTRY under the frame lock
+  FRAME_CRITICAL
+  {
+    if (entry->status == LOADED)
+      {
+        struct vm_frame *frame = frame_find_entry (entry->kpage);
+        ASSERT (frame != NULL);
+        if (frame->cow_cnt > 0 || frame_may_pin ())
+          {
+            if (frame->cow_cnt == 0)
+              cow_frames++;
+            frame->cow_cnt = frame->cow_cnt == 0 ? 2 : frame->cow_cnt + 1;
+            frame->pin = true;
+            pagedir_set_writable (owner->pagedir, entry->upage, false);
+            entry->cow = true;
+            kpage = entry->kpage;
+          }
+      }
+  }
+  return kpage;
+}
+
+/* Gives the current process a private copy of copy-on-write
+   frame KPAGE, to map at UPAGE, and drops its reference to
+   KPAGE.  If no other process shares KPAGE, it becomes the
+   private copy.  Returns the copy, pinned, or NULL if out of
+   memory. */
+void *
+vm_frame_unshare_cow (void *kpage, void *upage)
+{
+  bool last = false;
+
+  FRAME_CRITICAL
+  {
+    struct vm_frame *frame = frame_find_entry (kpage);
+    ASSERT (frame != NULL && frame->cow_cnt > 0);
+    if (frame->cow_cnt == 1)
+      {
+        frame->cow_cnt = 0;
+        cow_frames--;
+        frame->owner = thread_current ();
+        frame->upage_addr = upage;
+        last = true;
+      }
+  }
+  if (last)
+    return kpage;
+
+  void *copy = vm_frame_allocate (PAL_USER, upage);
+  if (copy == NULL)
+    return NULL;
+  memcpy (copy, kpage, PGSIZE);
+  vm_frame_put_cow (kpage);
+  return copy;
+}
+
+/* Drops a reference to copy-on-write frame KPAGE, freeing it with
+   the last one.  The caller must have removed its own mapping. */
+void
+vm_frame_put_cow (void *kpage)
+{
+  bool last;
+
+  FRAME_CRITICAL
+  {
+    struct vm_frame *frame = frame_find_entry (kpage);
+    ASSERT (frame != NULL && frame->cow_cnt > 0);
+    last = --frame->cow_cnt == 0;
+    if (last)
+      cow_frames--;
+  }
+  if (last)
+    vm_frame_free (kpage, true);
+}
+
+/* Keeps the frame holding ENTRY's page, of the current process,
+   from being evicted until vm_frame_unhold(), so that asynchronous
+   I/O can reach it through the kernel.  Returns false if the page
+   is not in a frame, because it has been evicted, or if too many
+   frames are pinned already. */
+bool
+vm_frame_hold (struct sup_page_entry *entry)
+{
+  bool success = false;
+
+  // eviction changes ENTRY under the frame lock
+  FRAME_CRITICAL
+  {
+    if (entry->status == LOADED)
+      {
+        struct vm_frame *frame = frame_find_entry (entry->kpage);
+        ASSERT (frame != NULL);
+        if (frame->hold_cnt > 0 || frame_may_pin ())
+          {
+            if (frame->hold_cnt++ == 0)
+              held_frames++;
+            success = true;
+          }
+      }
+  }
+  return success;
+}
+
+/* Drops a hold on frame KPAGE taken by vm_frame_hold(). */
+void
+vm_frame_unhold (void *kpage)
+{
+  FRAME_CRITICAL
+  {
+    struct vm_frame *frame = frame_find_entry (kpage);
+    ASSERT (frame != NULL && frame->hold_cnt > 0);
+    if (--frame->hold_cnt == 0)
+      held_frames--;
+  }
+}
+
 void
 vm_frame_pin_upd (void *kpage, bool pin)
 {
@@ -247,4 +598,24 @@ new_frame (void *kpage, void *upage, struct thread *owner)
       f->upage_addr = upage;
     }
   return f;
-}
\ No newline at end of file
+}
+
+static unsigned int
+share_hash_function (const struct hash_elem *e, void *aux UNUSED)
+{
+  struct vm_frame *n = hash_entry (e, struct vm_frame, share_elem);
+  return hash_int ((int)n->inode) ^ hash_int (n->ofs) ^ hash_int (n->len);
+}
+
+static bool
+share_less_function (const struct hash_elem *a, const struct hash_elem *b,
+                     void *aux UNUSED)
+{
+  struct vm_frame *node_a = hash_entry (a, struct vm_frame, share_elem);
+  struct vm_frame *node_b = hash_entry (b, struct vm_frame, share_elem);
+  if (node_a->inode != node_b->inode)
+    return node_a->inode < node_b->inode;
+  if (node_a->ofs != node_b->ofs)
+    return node_a->ofs < node_b->ofs;
+  return node_a->len < node_b->len;
+}
@@ -1,10 +1,14 @@
 #ifndef VM_FRAME_H
 #define VM_FRAME_H
+#include "filesys/file.h"
+#include "filesys/off_t.h"
 #include "lib/kernel/hash.h"
 #include "lib/kernel/list.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 
+struct sup_page_entry;
+
 struct vm_frame
 {
   /* physical (kernel) address of this frame */
@@ -19,6 +23,25 @@ struct vm_frame
    * need: */
   bool pin;
 
+  /* a read-only file page shared by processes: the file's inode,
+     the page's offset in it and the bytes read from there, and the
+     sup_page_entry of every mapping (see share_elem there).
+     inode is NULL for a private frame. */
+  struct inode *inode;
+  off_t ofs;
+  uint32_t len;
+  struct list sharers;
+  struct hash_elem share_elem;
+
+  /* number of processes mapping this frame copy-on-write after
+     fork(), or 0 for a private frame.  Shared this way, the frame
+     stays pinned. */
+  unsigned cow_cnt;
+
+  /* number of asynchronous I/O requests reaching the frame through
+     the kernel, which keep it from being evicted. */
+  unsigned hold_cnt;
+
   /* hash map element, used for quick search*/
   struct hash_elem hash_elem;
   /* list element to implement LRU */
@@ -31,4 +54,19 @@ void vm_frame_init (void);
 void *vm_frame_allocate (enum palloc_flags flags, void *upage);
 void vm_frame_free (void *kpage, bool free_resource);
 void vm_frame_access (void *);
+
+/* Read-only file pages shared between processes. */
+bool vm_frame_map_shared (struct sup_page_entry *, uint32_t *pd);
+bool vm_frame_fork_shared (struct sup_page_entry *parent,
+                           struct sup_page_entry *child, uint32_t *pd);
+void vm_frame_put_shared (struct sup_page_entry *);
+
+/* Private pages shared copy-on-write between forked processes. */
+void *vm_frame_share_cow (struct thread *owner, struct sup_page_entry *);
+void *vm_frame_unshare_cow (void *kpage, void *upage);
+void vm_frame_put_cow (void *kpage);
+
+/* Frames used by asynchronous I/O. */
+bool vm_frame_hold (struct sup_page_entry *);
+void vm_frame_unhold (void *kpage);
 #endif // VM_FRAME_H
@@ -3,6 +3,8 @@
 
 static struct sup_page_entry *vm_ste_new (void);
 
+size_t vm_stack_limit = VM_STACK_LIMIT_DEFAULT;
+
 /* helper functions */
 static hash_hash_func page_hash_function;
 static hash_less_func page_less_function;
@@ -14,6 +16,8 @@ vm_sup_page_create (void)
 {
   struct vm_sup_page_table *table
       = (struct vm_sup_page_table *)malloc (sizeof (struct vm_sup_page_table));
+  if (table == NULL)
+    return NULL;
   hash_init (&table->hash_table, page_hash_function, page_less_function, NULL);
   return table;
 }
@@ -157,6 +161,13 @@ vm_sup_page_load_page (struct vm_sup_page_table *table, uint32_t *pd,
     {
       return true;
     }
+  // read-only executable pages are shared by every process
+  // running the same program
+  if (entry->status == IN_FILE && !entry->lazy_load.w && !entry->mapped)
+    {
+      thread_current ()->rusage.faults_file++;
+      return vm_frame_map_shared (entry, pd);
+    }
   void *kpage = vm_frame_allocate (PAL_USER, upage);
   if (kpage == NULL)
     {
@@ -168,9 +179,11 @@ vm_sup_page_load_page (struct vm_sup_page_table *table, uint32_t *pd,
     {
     case ZERO:
       memset (kpage, 0, PGSIZE);
+      thread_current ()->rusage.faults_zero++;
       break;
     case IN_FILE:
       {
+        thread_current ()->rusage.faults_file++;
         off_t ofs = entry->lazy_load.ofs;
         uint32_t len = entry->lazy_load.len;
         struct file *f = entry->lazy_load.f;
@@ -179,7 +192,7 @@ vm_sup_page_load_page (struct vm_sup_page_table *table, uint32_t *pd,
         file_seek (f, ofs);
         if ((off_t)len != file_read (f, kpage, len))
           {
-            // something wrong in file system read...
+            vm_frame_free (kpage, true);
             return false;
           }
         // lazy load PAGE: bytes_to_read + zero_bytes
@@ -188,6 +201,7 @@ vm_sup_page_load_page (struct vm_sup_page_table *table, uint32_t *pd,
       break;
     case ON_SWAP:
       vm_swap_load (kpage, entry->swap_slot);
+      thread_current ()->rusage.faults_swap++;
       break;
     default:
       PANIC ("unreachable code");
@@ -198,6 +212,7 @@ vm_sup_page_load_page (struct vm_sup_page_table *table, uint32_t *pd,
   if (!pagedir_set_page (pd, upage, kpage, entry->writable))
     {
       // Memory allocation failed.
+      vm_frame_free (kpage, true);
       return false;
     }
   // Clean page
@@ -210,6 +225,160 @@ vm_sup_page_load_page (struct vm_sup_page_table *table, uint32_t *pd,
   return true;
 }
 
+bool
+vm_sup_page_fork (struct vm_sup_page_table *table, uint32_t *pd,
+                  struct thread *parent, struct file *image)
+{
+  struct hash_iterator i;
+
+  // the parent waits in fork() meanwhile, only eviction changes its pages
+  hash_first (&i, &parent->supplemental_table->hash_table);
+  while (hash_next (&i))
+    {
+      struct sup_page_entry *p
+          = hash_entry (hash_cur (&i), struct sup_page_entry, hash_elem);
+      if (p->mapped)
+        continue;
+
+      struct sup_page_entry *entry = vm_ste_new ();
+      if (entry == NULL)
+        return false;
+      *entry = *p;
+      entry->kpage = NULL;
+      entry->shared = false;
+      entry->cow = false;
+      if (hash_insert (&table->hash_table, &entry->hash_elem) != NULL)
+        {
+          free (entry);
+          return false;
+        }
+
+      // text shared by every process running the program, read
+      // from the file again if it has been evicted
+      if (p->shared)
+        {
+          if (!vm_frame_fork_shared (p, entry, pd))
+            {
+              entry->status = IN_FILE;
+              entry->lazy_load.f = image;
+            }
+          continue;
+        }
+
+      void *kpage = NULL;
+      if (p->status == LOADED
+          && (kpage = vm_frame_share_cow (parent, p)) != NULL)
+        entry->cow = true;
+
+      if (kpage != NULL)
+        {
+          if (!pagedir_set_page (pd, entry->upage, kpage, false))
+            {
+              // cleaned up with the rest when the table is destroyed
+              entry->kpage = kpage;
+              return false;
+            }
+          entry->kpage = kpage;
+          continue;
+        }
+
+      // too many frames are pinned copy-on-write: refuse the fork
+      // (only eviction changes P, and not back to LOADED)
+      if (p->status == LOADED)
+        {
+          entry->status = ZERO;
+          return false;
+        }
+
+      // evicted since the parent loaded it: a private copy from SWAP
+      if (p->status == ON_SWAP)
+        {
+          kpage = vm_frame_allocate (PAL_USER, entry->upage);
+          if (kpage == NULL)
+            {
+              entry->status = ZERO;
+              return false;
+            }
+          // may have been evicted just now; it stays ON_SWAP then
+          ASSERT (p->status == ON_SWAP);
+          vm_swap_read (kpage, p->swap_slot);
+          entry->status = LOADED;
+          entry->kpage = kpage;
+          if (!pagedir_set_page (pd, entry->upage, kpage, entry->writable))
+            {
+              vm_frame_free (kpage, true);
+              entry->kpage = NULL;
+              entry->status = ZERO;
+              return false;
+            }
+          vm_frame_pin_upd (kpage, false);
+        }
+      else if (p->status == IN_FILE)
+        {
+          entry->status = IN_FILE;
+          entry->lazy_load.f = image;
+        }
+    }
+  return true;
+}
+
+bool
+vm_sup_page_unshare (struct vm_sup_page_table *table, uint32_t *pd,
+                     void *upage)
+{
+  struct sup_page_entry *entry = vm_sup_page_find_entry (table, upage);
+  if (entry == NULL || !entry->cow || !entry->writable)
+    return false;
+
+  void *kpage = vm_frame_unshare_cow (entry->kpage, upage);
+  if (kpage == NULL)
+    return false;
+  if (kpage != entry->kpage)
+    {
+      // cannot fail: the page table holding UPAGE's entry exists
+      pagedir_clear_page (pd, upage);
+      pagedir_set_page (pd, upage, kpage, true);
+      entry->kpage = kpage;
+    }
+  else
+    pagedir_set_writable (pd, upage, true);
+  entry->cow = false;
+  vm_frame_pin_upd (kpage, false);
+  thread_current ()->rusage.faults_cow++;
+  return true;
+}
+
+bool
+vm_sup_page_pin (struct vm_sup_page_table *table, uint32_t *pd, void *upage,
+                 bool write)
+{
+  struct sup_page_entry *entry = vm_sup_page_find_entry (table, upage);
+  if (entry == NULL || (write && !entry->writable))
+    return false;
+
+  for (;;)
+    {
+      if (!vm_sup_page_load_page (table, pd, upage))
+        return false;
+      if (entry->cow && entry->writable
+          && !vm_sup_page_unshare (table, pd, upage))
+        return false;
+      if (vm_frame_hold (entry))
+        return true;
+      // refused, rather than evicted again before it was held
+      if (entry->status == LOADED)
+        return false;
+    }
+}
+
+void
+vm_sup_page_unpin (uint32_t *pd, void *upage)
+{
+  void *kpage = pagedir_get_page (pd, upage);
+  ASSERT (kpage != NULL);
+  vm_frame_unhold (kpage);
+}
+
 /* Find the hash element with the given upage. Returns NULL if it doesn't
  * exist. */
 struct sup_page_entry *
@@ -247,8 +416,17 @@ page_destroy_function (struct hash_elem *e, void *aux UNUSED)
   // caller make sure that map sections are removed before sup-table destory
   ASSERT (!n->mapped);
 
-  // Free the frame
-  if (n->kpage != NULL)
+  // Free the frame.  pagedir_destroy() frees private frames, but
+  // a shared frame must outlive the mapping in this (the current)
+  // process, so that mapping is removed here.
+  if (n->shared)
+    vm_frame_put_shared (n);
+  else if (n->kpage != NULL && n->cow)
+    {
+      pagedir_clear_page (thread_current ()->pagedir, n->upage);
+      vm_frame_put_cow (n->kpage);
+    }
+  else if (n->kpage != NULL)
     vm_frame_free (n->kpage, false);
   // discard the pages in SWAP
   if (n->status == ON_SWAP)
@@ -263,7 +441,8 @@ vm_ste_new ()
   struct sup_page_entry *entry
       = (struct sup_page_entry *)calloc (sizeof (struct sup_page_entry), 1);
   // pages are writable by default
-  entry->writable = true;
+  if (entry != NULL)
+    entry->writable = true;
   return entry;
 }
 
@@ -274,4 +453,22 @@ vm_sup_page_writeback (struct sup_page_entry *entry)
   struct file *f = entry->lazy_load.f;
   file_seek (f, entry->lazy_load.ofs);
   file_write (f, entry->kpage, entry->lazy_load.len);
-}
\ No newline at end of file
+}
+
+bool
+vm_sup_page_grow_stack (struct vm_sup_page_table *table, uint32_t *pd,
+                        void *fault_addr, void *esp)
+{
+  uint8_t *addr = fault_addr;
+  if (!is_user_vaddr (addr)
+      || (uintptr_t)PHYS_BASE - (uintptr_t)addr > vm_stack_limit)
+    return false;
+  // PUSH faults 4 bytes and PUSHA 32 bytes below esp before moving it;
+  // anything further down is a wild access, not stack growth
+  if (esp == NULL || addr + 32 < (uint8_t *)esp)
+    return false;
+
+  void *upage = pg_round_down (addr);
+  return vm_sup_page_install_zero_page (table, upage)
+         && vm_sup_page_load_page (table, pd, upage);
+}
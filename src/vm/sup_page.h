@@ -52,6 +52,20 @@ struct sup_page_entry
   /* whether this page is a memory-file mapping */
   bool mapped;
 
+  /* whether this page is a read-only executable page in a frame
+     shared with other processes, see vm_frame_map_shared().  The
+     entry is then in the frame's sharers through share_elem, and
+     mapped in page directory share_pd.  Eviction turns it back
+     into an IN_FILE page. */
+  bool shared;
+  struct list_elem share_elem;
+  uint32_t *share_pd;
+
+  /* whether this page is in a frame shared copy-on-write with
+     forked processes, see vm_frame_share_cow().  The page is
+     mapped read-only until the process writes to it. */
+  bool cow;
+
   /*
   a lazy load page from the ELF executable file
   Only applicable when `status==IN_FILE ||`
@@ -106,4 +120,49 @@ void vm_sup_page_unmap (struct vm_sup_page_table *table, void *upage_begin,
 /* writeback a mmap page */
 void vm_sup_page_writeback (struct sup_page_entry *entry);
 
+/*
+  copy the pages of process `parent` into `table` and page directory `pd`
+  of the current (forked) process. Loaded pages are shared copy-on-write,
+  pages not loaded yet are read from `image`, the child's executable.
+  Memory-mapped files are not inherited.
+ */
+bool vm_sup_page_fork (struct vm_sup_page_table *table, uint32_t *pd,
+                       struct thread *parent, struct file *image);
+/*
+  give the current process a private, writable copy of copy-on-write
+  page `upage`. Returns false if `upage` is not such a page, or out of
+  memory.
+ */
+bool vm_sup_page_unshare (struct vm_sup_page_table *table, uint32_t *pd,
+                          void *upage);
+
+/*
+  load page `upage` of the current process and keep it in its frame
+  until vm_sup_page_unpin(), for asynchronous I/O done by other
+  threads.  A writable page is first made private, breaking
+  copy-on-write, so that the process keeps that frame.  Returns false
+  if `upage` is not a page of the process, `write` is set and it is
+  read-only, too many frames are pinned, or out of memory.
+ */
+bool vm_sup_page_pin (struct vm_sup_page_table *table, uint32_t *pd,
+                      void *upage, bool write);
+/*
+  let page `upage`, pinned by vm_sup_page_pin() in page directory `pd`,
+  be evicted again. May be called by any thread.
+ */
+void vm_sup_page_unpin (uint32_t *pd, void *upage);
+
+/* default of `vm_stack_limit`, 8 MB */
+#define VM_STACK_LIMIT_DEFAULT (8 * 1024 * 1024)
+/* how far below PHYS_BASE a user stack may grow, see -sl option */
+extern size_t vm_stack_limit;
+/*
+  grow the stack of the current process by a zero page covering
+  `fault_addr`, if the access looks like a stack access for user stack
+  pointer `esp` and is within `vm_stack_limit`. Returns false otherwise,
+  or out of memory.
+ */
+bool vm_sup_page_grow_stack (struct vm_sup_page_table *table, uint32_t *pd,
+                             void *fault_addr, void *esp);
+
 #endif // SUP_PAGE_H
\ No newline at end of file
@@ -2,8 +2,10 @@
 #include "bitmap.h"
 #include "devices/block.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/syscall.h" // for err_exit
+#include <stdio.h>
 
 static struct block *swap_block;
 static char *bitmap_buf[512];
@@ -53,6 +55,7 @@ vm_swap_save (void *page)
     {
       block_write (swap_block, sec, page);
     }
+  thread_current ()->rusage.swap_outs++;
   DEBUG_PRINT ("[VM.SWAP] save k-page at %p finished\n", page);
   return idx;
 }
@@ -78,9 +81,26 @@ vm_swap_load (void *page, swap_idx idx)
     {
       block_read (swap_block, sec, page);
     }
+  thread_current ()->rusage.swap_ins++;
   DEBUG_PRINT ("[VM.SWAP] load k-page for %p from %u. finished\n", page, idx);
 }
 
+void
+vm_swap_read (void *page, swap_idx idx)
+{
+  // swap must be enabled
+  ASSERT (swap_block);
+  ASSERT (page >= PHYS_BASE);
+  // the slot stays occupied: its owner still has the page there
+  ASSERT (bitmap_test (used_slots, idx));
+  for (uint32_t i = 0, sec = idx * SEC_PER_FRAME; i < SEC_PER_FRAME;
+       i++, sec++, page += BLOCK_SECTOR_SIZE)
+    {
+      block_read (swap_block, sec, page);
+    }
+  thread_current ()->rusage.swap_ins++;
+}
+
 void
 vm_swap_discard (swap_idx idx)
 {
@@ -26,6 +26,12 @@ swap_idx vm_swap_save (void *page);
 */
 void vm_swap_load (void *page, swap_idx swap_idx);
 
+/*
+  copy the frame stored at `swap_idx` into the frame starting at `page`,
+  leaving it in SWAP
+*/
+void vm_swap_read (void *page, swap_idx swap_idx);
+
 /*
   discard the frame stored in SWAP index by `swap_idx`.
   when a process exits, all the pages in SWAP should be discarded.